@@ -0,0 +1,193 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "adc.h"
+
+#if ADC_OSR_BITS > 3
+#error "ADC_OSR_BITS above 3 overflows the 16 bit accumulator"
+#endif
+
+static volatile uint16_t ring[ADC_RING];
+static uint32_t ring_sum;
+static volatile uint8_t head;
+static uint16_t acc;
+static uint8_t n;
+
+static volatile uint16_t latest, filtered, count;
+static volatile uint8_t seq;	/* bumped after every update, readers retry on change */
+
+/* Raw conversion limit, see adc_limit() */
+static uint16_t limit = 0xFFFF;
+static void (*over)(void);
+
+/* PWM-synchronous mode, see adc_init_sync() */
+static void (*sync_step)(uint16_t);
+static uint8_t sync_div;
+static uint32_t sync_acc, sync_recip;
+static volatile uint8_t sync_busy;
+static volatile uint16_t sync_overruns;
+
+static void store(uint16_t s)
+{
+	ring_sum = ring_sum + s - ring[head];
+	ring[head] = s;
+	head = (head + 1) & (ADC_RING - 1);
+
+	latest = s;
+	filtered = ring_sum >> ADC_RING_BITS;
+	count++;
+	seq++;
+}
+
+static void sync_sample(void)
+{
+	uint16_t s;
+
+	TIFR0 = _BV(OCF0A);	/* the next compare match must raise the flag again */
+	sync_acc += ADC;
+	if (++n < sync_div)
+		return;
+	s = (sync_acc*sync_recip) >> 16;
+	sync_acc = 0;
+	n = 0;
+	store(s);
+
+	if (sync_busy) {
+		sync_overruns++;
+		return;
+	}
+	sync_busy = 1;
+	sei();
+	sync_step(s);
+	cli();
+	sync_busy = 0;
+}
+
+ISR(ADC_vect)
+{
+	uint16_t s;
+
+	if (ADC > limit)
+		over();
+	if (sync_step) {
+		sync_sample();
+		return;
+	}
+	acc += ADC;
+	if (++n < (1 << (2*ADC_OSR_BITS)))
+		return;
+	s = acc >> ADC_OSR_BITS;
+	acc = 0;
+	n = 0;
+	store(s);
+}
+
+void adc_init(uint8_t channel)
+{
+	uint16_t s;
+	uint8_t i;
+
+	/* REFSx = 0 : Select AREF as reference
+	 * ADLAR = 0 : Right shift result
+	 */
+	ADMUX = channel & 0x07;
+	ADCSRB = 0;	/* ADTSx = 0 : free running */
+	/* F_ADC = F_CPU / 64 = 187.5 kHz, one conversion every 13 ADC clocks */
+	ADCSRA = _BV(ADEN) | _BV(ADPS2) | _BV(ADPS1);
+
+	/* Seed the ring with one blocking conversion so the mean starts valid */
+	ADCSRA |= _BV(ADSC);
+	while (ADCSRA & _BV(ADSC));
+	s = ADC << ADC_OSR_BITS;
+	for (i = 0; i < ADC_RING; i++)
+		ring[i] = s;
+	ring_sum = (uint32_t)s << ADC_RING_BITS;
+	latest = filtered = s;
+
+	ADCSRA |= _BV(ADATE) | _BV(ADIE) | _BV(ADSC);
+}
+
+static uint16_t read_seq(volatile uint16_t *v)
+{
+	uint8_t s;
+	uint16_t x;
+	do {
+		s = seq;
+		x = *v;
+	} while (s != seq);
+	return x;
+}
+
+void adc_init_sync(uint8_t channel, uint8_t phase, uint8_t div, void (*step)(uint16_t))
+{
+	uint8_t t2 = TCCR2B;
+
+	adc_init(channel);
+	ADCSRA &= ~(_BV(ADATE) | _BV(ADIE));
+	while (ADCSRA & _BV(ADSC));
+
+	sync_div = div ? div : 1;
+	/* sum*recip >> 16 is the mean with ADC_OSR_BITS extra bits */
+	sync_recip = (1UL << (16 + ADC_OSR_BITS))/sync_div;
+	sync_acc = 0;
+	n = 0;
+	sync_step = step;
+
+	/* Both timers stopped, cleared and restarted back to back */
+	TCCR2B = 0;
+	TCCR0B = 0;
+	TCCR0A = _BV(WGM01) | _BV(WGM00);	/* fast PWM, TOP 0xFF, no output */
+	OCR0A = phase;
+	TCNT0 = 0;
+	TCNT2 = 0;
+	TCCR2B = t2;
+	TCCR0B = _BV(CS00);
+	TIFR0 = _BV(OCF0A);
+
+	ADCSRB = _BV(ADTS1) | _BV(ADTS0);	/* Timer0 compare match A */
+	/* F_ADC = F_CPU/16, 13 ADC clocks = 208 cycles, inside one period */
+	ADCSRA = _BV(ADEN) | _BV(ADPS2) | _BV(ADATE) | _BV(ADIE) | _BV(ADIF);
+}
+
+void adc_limit(uint16_t raw, void (*trip)(void))
+{
+	uint8_t sreg = SREG;
+	cli();
+	over = trip;
+	limit = trip ? raw : 0xFFFF;
+	SREG = sreg;
+}
+
+uint16_t adc_sync_overruns(void)
+{
+	return read_seq(&sync_overruns);
+}
+
+/* Newest decimated sample, ADC_BITS wide */
+uint16_t adc_latest(void)
+{
+	return read_seq(&latest);
+}
+
+/* Mean of the last ADC_RING samples, ADC_BITS wide */
+uint16_t adc_filtered(void)
+{
+	return read_seq(&filtered);
+}
+
+/* Sample from age periods ago, 0 is the newest */
+uint16_t adc_history(uint8_t age)
+{
+	uint8_t s;
+	uint16_t x;
+	do {
+		s = seq;
+		x = ring[(head - 1 - age) & (ADC_RING - 1)];
+	} while (s != seq);
+	return x;
+}
+
+/* Number of decimated samples produced, wraps at 2^16 */
+uint16_t adc_count(void)
+{
+	return read_seq(&count);
+}
@@ -0,0 +1,51 @@
+#ifndef ADC_H
+#define ADC_H
+
+#include <stdint.h>
+
+/* Free-running ADC sampled from ADC_vect.
+ *
+ * Every 4^ADC_OSR_BITS conversions are summed and decimated into one
+ * sample with ADC_OSR_BITS extra bits of resolution (the converter's
+ * switching ripple provides the dither this needs). Decimated samples go
+ * into a ring of 2^ADC_RING_BITS entries with a running sum, so readers get
+ * the newest sample or the ring mean in O(1) without waiting on ADSC.
+ *
+ * adc_init_sync() switches to conversions in step with the Timer2 PWM
+ * carrier: Timer0 is restarted alongside Timer2 and its compare A, at
+ * count phase (plus about 2 for the restart), triggers one conversion per
+ * carrier period, F_CPU/256 = 46.9 kHz. The switching ripple is then
+ * sampled at the same point every period and cannot alias. Each group of
+ * div conversions is averaged into one ADC_BITS sample, which goes into
+ * the ring and to step(), so step() runs at 46.9 kHz/div. step() is called
+ * with interrupts enabled so conversions keep being summed; if it is still
+ * running when the next sample is due, that call is skipped and counted by
+ * adc_sync_overruns(). The ADC clock is F_CPU/16 in this mode, faster than
+ * the converter's full accuracy range, which the averaging makes up for.
+ * Call it after hal_pwm_init().
+ *
+ * adc_limit() has ADC_vect call trip() on any single conversion above raw,
+ * before it is summed, so the check does not wait for decimation.
+ */
+
+#ifndef ADC_OSR_BITS
+#define ADC_OSR_BITS	2	/* 16 conversions per sample, 12 bit result */
+#endif
+#ifndef ADC_RING_BITS
+#define ADC_RING_BITS	3	/* 8 sample ring */
+#endif
+
+#define ADC_BITS	(10 + ADC_OSR_BITS)
+#define ADC_READ_MAX	(1023U << ADC_OSR_BITS)
+#define ADC_RING	(1 << ADC_RING_BITS)
+
+void adc_init(uint8_t channel);
+uint16_t adc_latest(void);
+uint16_t adc_filtered(void);
+uint16_t adc_history(uint8_t age);
+uint16_t adc_count(void);
+void adc_init_sync(uint8_t channel, uint8_t phase, uint8_t div, void (*step)(uint16_t));
+uint16_t adc_sync_overruns(void);
+void adc_limit(uint16_t raw, void (*trip)(void));
+
+#endif
@@ -3,9 +3,8 @@
 // 
 //          - F_CPU must be defined to match the clock frequency
 //
-//          - Compile with the options to enable floating point
-//            numbers in printf(): 
-//               -Wl,-u,vfprintf -lprintf_flt -lm
+//          - Numbers are formatted by fmt.c, so the floating point
+//            printf (-u vfprintf -lprintf_flt) is not needed
 //
 //          - Pin assignment: 
 //            | Port | Pin | Use                         |
@@ -15,20 +14,20 @@
 //            | D    | PD1 | Host connection RX (yellow) |
 //            | D    | PD7 | PWM out to drive MOSFET     |
 //
-/* avr-gcc -mmcu=atmega644p -DF_CPU=12000000 -Wall -Os -Wl,-u,vfprintf -lprintf_flt -lm boost.c -o boost.elf
+/* avr-gcc -mmcu=atmega644p -DF_CPU=12000000 -Wall -Os boost.c -o boost.elf -L. -llcd -lm
  avr-objcopy -O ihex boost.elf boost.hex
  avrdude -c usbasp -p m644p -U flash:w:boost.hex */
  
  //avr-gcc -mmcu=atmega644p -L ./ -o text.elf text.o -llcd
  
- //avr-gcc -u vfprintf -lprintf_flt -lm -mmcu=atmega644p -DF_CPU=12000000 -Wall -Os -c boost.c -o boost.o
- //avr-gcc -mmcu=atmega644p -u vfprintf -lprintf_flt -lm -L.\ -o boost.exe boost.o -llcd
+ //avr-gcc -mmcu=atmega644p -DF_CPU=12000000 -Wall -Os -c boost.c -o boost.o
+ //avr-gcc -mmcu=atmega644p -L.\ -o boost.exe boost.o -llcd -lm
  //avr-objcopy -O ihex boost.exe boost.hex
  //avrdude -c usbasp -p m644p -U flash:w:boost.hex
  
  /*
- avr-gcc -mmcu=atmega644p -DF_CPU=12000000 -Wall -u vprintf -lprintf_flt -lm -Os -c boost.c -o boost.o
- avr-gcc -mmcu=atmega644p -L .\ -u vprintf -lprintf_flt -lm -Os boost.o -llcd boost.elf
+ avr-gcc -mmcu=atmega644p -DF_CPU=12000000 -Wall -Os -c boost.c -o boost.o
+ avr-gcc -mmcu=atmega644p -L .\ -Os boost.o -llcd -lm -o boost.elf
  avr-objcopy -o ihex boost.elf boost.hex
  avrdude -c usbasp -p m644p -U flash:w:boost.hex
  
@@ -41,11 +40,21 @@
 #include <avr/interrupt.h>
 #include <stdlib.h>
 #include "lcd.h"
+#include "pid.h"
+#include "hal.h"
+#include "cmd.h"
+#include "telem.h"
+#include "fmt.h"
+#include "field.h"
+#include "sched.h"
+#include "prof.h"
+#include "params.h"
+#include "prot.h"
 #include <string.h>
 
 
 #define DELAY_MS      500
-#define BDRATE_BAUD  9600
+#define BDRATE_BAUD  57600 //U2X, 0.16% fast; TELEM_HZ frames take 2600 of its 5760 B/s
 
 #define ADCREF_V     3.3
 #define ADCMAXREAD   1023   /* 10 bit ADC */
@@ -56,312 +65,406 @@
    output voltage for your circuit:
 */
 #define PWM_DUTY_MAX 240    /* 94% duty cycle */
+#ifndef PWM_DITHER
+#define PWM_DITHER 1        /* 8.8 duty, sigma-delta over carrier periods (hal.h) */
+#endif
 
 #define VOUTMAX 15
 #define VOUTMIN 1.5
+#define VSET_MIN 2     /* lowest target v and the EEPROM accept */
+
+/* Gain limits for p/i/d and the EEPROM, out of range falls back to the default */
+#define KP_MIN 0.001
+#define KP_MAX 0.004
+#define KP_DEF 0.004
+#define KI_MIN 0.001
+#define KI_MAX 0.01
+#define KI_DEF 0.005
+#define KD_MIN 0.00005
+#define KD_MAX 0.00015
+#define KD_DEF 0.0001
+#ifndef OVP_V
+#define OVP_V   16.5  /* PWM cut in the ADC ISR above this (prot.h) */
+#endif
+
+/* Control runs in the tick ISR, the rest are main loop tasks (sched.h) */
+#define CTRL_HZ  1000
+/* Or, built with -DCTRL_SYNC=1, from ADC_vect on conversions in step with
+   the PWM carrier, every CTRL_DIV periods (adc.h); 46875/47 = 997 Hz */
+#ifndef CTRL_SYNC
+#define CTRL_SYNC 0
+#endif
+#define CTRL_DIV   47
+/* S/H about 64 counts into the carrier: clear of both switching edges while
+   OCR2A is above about 72, 30% duty or Vout over about 7 V from 5 V in. At
+   lower duty, down to 10% (OCR2A 24), it lands just after turn-off. */
+#define ADC_PHASE  32
+/* pid_init() dt, a per-step scaling rather than the 1 ms step. It dates
+   from the old 100 Hz tick; control moved to CTRL_HZ with it unchanged, so
+   each gain acts 10x as often a second and the 100 Hz gains overshot 57%
+   and never settled. The KP/KI/KD defaults and ranges above are retuned
+   at 1 kHz with ./tune (8-12 V, 50-500 R): 69 ms to 2%, 28% overshoot. */
+#define PID_DT   0.01
+#define TELEM_HZ 200
+#define LCD_HZ   10
+#define LED_HZ   5
+#define PARAM_TICKS 4  /* EEPROM byte writes take 3.4 ms */
 		
-void init_stdio2uart0(void);
-int uputchar0(char c, FILE *stream);
-int ugetchar0(FILE *stream);
-		
-void init_adc(void);
 double v_load(void);
 
-void init_pwm(void);
-void pwm_duty(double x);
+void pwm_duty(uint16_t x);
 
 void led_light(void);
 
 void init_Interrupts(void);
+void init_display(void);
 void display_lcd(void);
-
-volatile uint8_t Vout_target = 10; //Target Vout
-volatile double error, error_int, error_dif, error_old = 0; //Initializes all errors for PID control
-
-volatile double DutyCycle = 0.3; //Initializes DutyCycle
-volatile double PWM;
-
-volatile char buffer[1];
-volatile char check[1];
-volatile char input0[1];
-volatile char input1[1];
-volatile char inputP1[1];
-volatile char inputP2[1];
-volatile char inputD1[1];
-volatile char inputD2[1];
-volatile char inputI1[1];
-volatile char inputI2[1];
-
-volatile int checknr;
-
-volatile double kP = 0.0015;
-volatile double kI = 0.00025;
-volatile double kD = 0.0005; 
+void apply_cmd(const cmd_line *line);
+void poll_cmd(void);
+void send_telem(void);
+void control(uint16_t adc);
+void boot_lcd(void);
+void boot_report(void);
+int32_t micro(double k);
+int16_t target_in_range(double v);
+double gain_in_range(double k, double min, double max, double def);
+
+volatile int16_t Vout_target = PID_VI(10); //Target Vout, Q5.10 volts
+pid ctrl; //Fixed-point PID state, updated by TIMER1_COMPA_vect
+const prot_policy ovp = {100, 200, 3, 2000}; //Ticks: 100 ms off, 200 ms soft start, 3 restarts per 2 s
+
+field vout_f, target_f, kP_f, kD_f, kI_f, error_f, pwm_f; //Values on the LCD, labels are drawn once
+sched_task *cmd_task; //Released by every received byte
+sched_task *boot_task; //Brings the LCD up a step at a time, after the control loop
+
+/* Boot timeline, sched_clock() counts from sei() */
+volatile uint16_t boot_reg_steps; //Control steps until first within 0.5 V, 0 before
+uint32_t boot_lcd_on, boot_ui_drawn;
+uint8_t lcd_up;
+
+volatile double kP = KP_DEF;
+volatile double kI = KI_DEF;
+volatile double kD = KD_DEF;
 
 
 ISR(INT0_vect){
 	if(v_load()/0.176 > VOUTMIN){
-		Vout_target--;
+		Vout_target -= PID_VI(1);
 	}
 	else{
-		Vout_target = 10;
+		Vout_target = PID_VI(10);
 	}
 }
 ISR(INT1_vect, ISR_NOBLOCK){
 	if(v_load()/0.176 < VOUTMAX){
-		Vout_target++;
+		Vout_target += PID_VI(1);
 	}
 	else{
-		Vout_target = 10;
+		Vout_target = PID_VI(10);
 	}
 }
 
 ISR(USART0_RX_vect){
-	scanf("%c", buffer); //Buffer to catch first input
-	printf("\n\r To Update Target Voltage, press '1' key.");
-	printf("\n\r To Update kP, press '2' key.");
-	printf("\n\r To Update kD , press '3' key.");
-	printf("\n\r To Update kI , press '4' key.");
-	_delay_ms(100);
-	fscanf(stdin, "%c", check);
-	checknr = atoi(check);
-	switch(checknr){
-		case 1:
-			printf("\n\rPlease enter your new voltage as two number keystrokes, they are added together.");
-			fscanf(stdin, "%c", input0); //First number inputted(0-9)
-			_delay_ms(200); 
-			fscanf(stdin, "%c", input1); //Second number inputted(0-9)
-			Vout_target = (atoi(input0)+atoi(input1));//Sum of first and second number assigned to Vout_target
-			if (Vout_target > 15 || Vout_target < 2) Vout_target = 10; //Ensures Vout_target does not go too low or too high
-			break;
-		
-		case 2:
-			printf("\n\rPlease enter your new value for kP, the number gets added then multiplied by a constant of 1e-4");
-			fscanf(stdin, "%c", input0); //First number inputted(0-9)
-			_delay_ms(200); 
-			fscanf(stdin, "%c", input1); //Second number inputted(0-9)
-			kP = ((atoi(input0)+atoi(input1))*1e-4);//Sum of first and second number assigned to kP, then multipled by constant
-			if(kP > 0.003 || kP < 0.0005) kP = 0.0015;
-			break;
-		case 3:
-			printf("\n\rPlease enter your new value for kD, the number gets added then multiplied by a constant of 1e-4");
-			fscanf(stdin, "%c", input0); //First number inputted(0-9)
-			_delay_ms(200); 
-			fscanf(stdin, "%c", input1); //Second number inputted(0-9)
-			kD = ((atoi(input0)+atoi(input1))*1e-4);//Sum of first and second number assigned to kP, then multipled by constant
-			if(kD > 0.002   || kP < 0.0001) kD = 0.0005;
-			break;
-		case 4:
-			printf("\n\rPlease enter your new value for kI, the number gets added then multiplied by a constant of 1e-5");
-			fscanf(stdin, "%c", input0); //First number inputted(0-9)
-			_delay_ms(200); 
-			fscanf(stdin, "%c", input1); //Second number inputted(0-9)
-			kI = ((atoi(input0)+atoi(input1))*1e-5);//Sum of first and second number assigned to kP, then multipled by constant
-			break;
-			if(kI > 0.0008 || kI < 0.00005) kI = 0.00025;
-		default:
-			printf("Please enter a valid number \n\n\n");
-	}
-	_delay_ms(500);
+	cmd_rx(hal_uart_getc()); //Queued for the parser in the main loop
+	sched_post(cmd_task);
 }
 
 
 ISR(TIMER1_COMPA_vect, ISR_NOBLOCK){
-	error = ((v_load()/0.176) - Vout_target);
-	error_dif = ((error - error_old)/0.01);
-	error_int = ((error_int + error) * 0.01);
-	DutyCycle = DutyCycle-(error*kP + error_int*kI + error_dif*kD);
-	if (DutyCycle > 0.95 || DutyCycle < 0.1){
-		DutyCycle = 0.3;
+	prof_enter(); //Latency and duration histograms, see prof.h; without control() when CTRL_SYNC
+	prot_tick(); //Restarts after an overvoltage trip
+#if !CTRL_SYNC
+	control(adc_latest());
+#endif
+	sched_tick(); //Releases the main loop tasks that are due
+	prof_exit();
+}
+
+/* One controller step on a fresh ADC_BITS sample */
+void control(uint16_t adc){
+	ctrl.target = Vout_target;
+	pid_update(&ctrl, PID_ADCX_TO_V(adc, ADC_OSR_BITS));
+	if(!boot_reg_steps){
+		static uint16_t steps;
+		steps++;
+		if(ctrl.error < PID_V(0.5) && ctrl.error > PID_V(-0.5)) boot_reg_steps = steps;
 	}
-	pwm_duty(DutyCycle);   /* Limited by PWM_DUTY_MAX */  
-	error_old = error;
+	if(!prot_running()) ctrl.duty = ctrl.duty_min; //Soft start from the bottom, not wound up
+	pwm_duty(prot_limit(pid_pwm16(&ctrl, PWM_DUTY_MAX)));   /* Limited by PWM_DUTY_MAX */
 }
 
 int main(void)
 {
-	uint16_t cnt =0;
-    DDRA |= _BV(PA2);
-	DDRA |= _BV(PA3);
-	init_stdio2uart0();
-	init_pwm(); 
-	init_adc();
+	hal_gpio_output(HAL_PORTA, PA2);
+	hal_gpio_output(HAL_PORTA, PA3);
+	hal_uart_init(BDRATE_BAUD);
+	hal_stdio_init();
+	hal_pwm_init();
+	hal_pwm_dither(PWM_DITHER);
+#if CTRL_SYNC
+	adc_init_sync(0, ADC_PHASE, CTRL_DIV, control);
+#else
+	adc_init(0);
+#endif
+	prot_init(&ovp, PROT_ADC(OVP_V));
+	pid_init(&ctrl, PID_DT, 0.3, 0.1, 0.95);
+	params saved;
+	if(params_load(&saved)){ //Last settings from EEPROM, checked as apply_cmd() checks them, else the defaults above
+		Vout_target = target_in_range(saved.target/(double)(1<<PID_VBITS));
+		kP = gain_in_range(saved.kP*1e-6, KP_MIN, KP_MAX, KP_DEF);
+		kI = gain_in_range(saved.kI*1e-6, KI_MIN, KI_MAX, KI_DEF);
+		kD = gain_in_range(saved.kD*1e-6, KD_MIN, KD_MAX, KD_DEF);
+	}
+	pid_set_gains(&ctrl, kP, kI, kD);
+	cmd_task = sched_add("cmd", poll_cmd, 0, 0);
+	sched_add("telem", send_telem, CTRL_HZ/TELEM_HZ, 1);
+	sched_add("led", led_light, CTRL_HZ/LED_HZ, 2);
+	sched_add("lcd", display_lcd, CTRL_HZ/LCD_HZ, 3);
+	sched_add("param", params_poll, PARAM_TICKS, 4);
+	boot_task = sched_add("boot", boot_lcd, 1, 5);
 	init_Interrupts();
-	sei(); //Enables all interrupts
-	
-	init_lcd();
-	set_orientation(North);
-	
+	sei(); //Enables all interrupts, control runs from here on
+
+	printf("\nEnter e.g. \"v12.5 p0.004 i0.005 d0.0001\", ? for help\n");
 
 	for(;;) {
-		led_light();
-		display_lcd();
-		
+		sched_run(); //Runs whatever the tick or the UART has released
+		hal_idle();
 	}
 }
 
-void display_lcd(){
-	char vout_s[20];
-	sprintf(vout_s, "%lf", (v_load()/0.176));
-	display.x = 10;
-	display.y = 10;
-	display_string("Vout = ");
-	display_string(vout_s);
-	display_string("V");
-	
-	char vout_target_s[20];
-	sprintf(vout_target_s, "%d", Vout_target);
-	display.x = 10;
-	display.y = 20;
-	display_string("Vout_target = ");
-	display_string(vout_target_s);
-	display_string("V");
-
-	char kP_s[20];
-	sprintf(kP_s, "%lf", kP);
-	display.x = 10;
-	display.y = 30;
-	display_string("kP = ");
-	display_string(kP_s);
-	
-	char kD_s[20];
-	sprintf(kD_s, "%lf", kD);
-	display.x = 10;
-	display.y = 40;
-	display_string("kD = ");
-	display_string(kD_s);
-	
-	char kI_s[20];
-	sprintf(kI_s, "%lf", kI);
-	display.x = 10;
-	display.y = 50;
-	display_string("kI = ");
-	display_string(kI_s);
-	
-	char error_string[20];
-	sprintf(error_string, "%lf", error);
-	display.x = 120;
-	display.y = 10;
-	display_string("error = ");
-	display_string(error_string);
-	
-	char PWM_string[20];
-	sprintf(PWM_string, "%d", ((int16_t)(DutyCycle*PWM_DUTY_MAX)));
-	display.x = 120;
-	display.y = 30;
-	display_string("PWM = ");
-	display_string(PWM_string);
+/* One init_lcd_step() per release, the next release after its wait */
+void boot_lcd(void){
+	uint8_t ms = init_lcd_step();
+	if(ms != LCD_READY){
+		sched_period(boot_task, ms ? ((uint16_t)ms*CTRL_HZ + 999)/1000 : 1);
+		return;
+	}
+	boot_lcd_on = sched_clock();
+	set_orientation(North);
+	lcd_tear_sync(1); //Field repaints wait for the panel's scan to pass
+	init_display();
+	boot_ui_drawn = sched_clock();
+	lcd_up = 1;
+	sched_period(boot_task, 0); //Done, never released again
 }
 
-void led_light(void){
-	if(error < 0.5 && error > -0.5){
-	PORTA |= _BV(PA2);
-	PORTA &= _BV(PA3);//Turns Red LED off
-	}
-	else if (error > 0.5 || error < -0.5){
-	PORTA &= _BV(PA3);	//Turns Red LED on
-	PORTA |= _BV(PA2);
-	}
+static uint32_t clock_ms(uint32_t counts){
+	return counts/(HAL_TICK_CLOCK/1000);
 }
 
-int uputchar0(char c, FILE *stream)
-{
-	if (c == '\n') uputchar0('\r', stream);
-	while (!(UCSR0A & _BV(UDRE0)));
-	UDR0 = c;
-	return c;
+void boot_report(void){
+	printf("boot, ms after sei(): regulating %lu, lcd on %lu, display drawn %lu\n",
+		(unsigned long)boot_reg_steps*1000/CTRL_HZ,
+		(unsigned long)clock_ms(boot_lcd_on), (unsigned long)clock_ms(boot_ui_drawn));
 }
 
-int ugetchar0(FILE *stream)
-{
-	while(!(UCSR0A & _BV(RXC0)));
-	return UDR0;
+void poll_cmd(void){
+	cmd_line line;
+	while(cmd_poll(&line)) apply_cmd(&line); //Never blocks, parses what has arrived
 }
 
-void init_stdio2uart0(void)
-{
-	/* Configure UART0 baud rate, one start bit, 8-bit, no parity and one stop bit */
-	UBRR0H = (F_CPU/(BDRATE_BAUD*16L)-1) >> 8;
-	UBRR0L = (F_CPU/(BDRATE_BAUD*16L)-1);
-	UCSR0B = _BV(RXEN0) | _BV(TXEN0);
-	UCSR0C = _BV(UCSZ00) | _BV(UCSZ01);
-
-	/* Setup new streams for input and output */
-	static FILE uout = FDEV_SETUP_STREAM(uputchar0, NULL, _FDEV_SETUP_WRITE);
-	static FILE uin = FDEV_SETUP_STREAM(NULL, ugetchar0, _FDEV_SETUP_READ);
-
-	/* Redirect all standard streams to UART0 */
-	stdout = &uout;
-	stderr = &uout;
-	stdin = &uin;
+/* Binary record when enabled, see telem.h, from a snapshot of the loop */
+void send_telem(void){
+	pid snap;
+	uint16_t adc;
+	if(!telem_enabled()) return;
+	cli();
+	snap = ctrl;
+	adc = adc_latest();
+	sei();
+	telem_record(adc, &snap);
 }
 
+void init_display(void){
+	field_label(10, 10, "Vout = ");
+	field_init(&vout_f, 52, 10, 7);
+	field_label(94, 10, "V");
+
+	field_label(10, 20, "Vout_target = ");
+	field_init(&target_f, 94, 20, 6);
+	field_label(130, 20, "V");
+
+	field_label(10, 30, "kP = ");
+	field_init(&kP_f, 40, 30, 8);
+	field_label(10, 40, "kD = ");
+	field_init(&kD_f, 40, 40, 8);
+	field_label(10, 50, "kI = ");
+	field_init(&kI_f, 40, 50, 8);
+
+	field_label(120, 10, "error = ");
+	field_init(&error_f, 168, 10, 7);
+	field_label(120, 30, "PWM = ");
+	field_init(&pwm_f, 156, 30, 3);
+}
 
-void init_adc (void)
-{
-    /* REFSx = 0 : Select AREF as reference
-     * ADLAR = 0 : Right shift result
-     *  MUXx = 0 : Default to channel 0
-     */
-    ADMUX = 0x00;
-    /*  ADEN = 1 : Enable the ADC
-     * ADPS2 = 1 : Configure ADC prescaler
-     * ADPS1 = 1 : F_ADC = F_CPU / 64
-     * ADPS0 = 0 :       = 187.5 kHz
-     */
-    ADCSRA = _BV(ADEN) | _BV(ADPS2) | _BV(ADPS1);
+/* Only characters that changed since the last pass reach the LCD */
+void display_lcd(){
+	if(!lcd_up) return; //Still booting
+	char s[FMT_BUF];
+
+	fmt_fixed(s, PID_ADCX_TO_V(adc_filtered(), ADC_OSR_BITS), PID_VBITS, 3, 7);
+	field_set(&vout_f, s);
+	fmt_fixed(s, Vout_target, PID_VBITS, 2, 6);
+	field_set(&target_f, s);
+	fmt_dec(s, micro(kP), 6, 8);
+	field_set(&kP_f, s);
+	fmt_dec(s, micro(kD), 6, 8);
+	field_set(&kD_f, s);
+	fmt_dec(s, micro(kI), 6, 8);
+	field_set(&kI_f, s);
+	fmt_fixed(s, ctrl.error, PID_VBITS, 3, 7);
+	field_set(&error_f, s);
+	fmt_int(s, pid_pwm(&ctrl, PWM_DUTY_MAX), 3);
+	field_set(&pwm_f, s);
 }
 
+/* Gain in millionths, as shown on the LCD and UART */
+int32_t micro(double k){
+	return (int32_t)(k*1e6 + (k < 0 ? -0.5 : 0.5));
+}
 
-double v_load(void)
-{
-     uint16_t adcread;
-         
-     /* Start single conversion */
-     ADCSRA |= _BV ( ADSC );
-     /* Wait for conversion to complete */
-     while ( ADCSRA & _BV ( ADSC ) );
-     adcread = ADC;
-    
-     //printf("ADC=%4d", adcread);  
- 
-     return (double) (adcread * ADCREF_V/ADCMAXREAD);
+/* Target from a command or the EEPROM, 10 V when out of range */
+int16_t target_in_range(double v){
+	return (v > VOUTMAX || v < VSET_MIN) ? PID_VI(10) : PID_V(v);
+}
+
+/* Gain from a command or the EEPROM, its default when out of range */
+double gain_in_range(double k, double min, double max, double def){
+	return (k > max || k < min) ? def : k;
 }
 
+/* Applies every field of a command line, or none of them if the line is bad.
+   Values out of range fall back to the defaults as before.
+*/
+void apply_cmd(const cmd_line *line){
+	double v, nP = kP, nI = kI, nD = kD;
+	int16_t target = Vout_target;
+	uint8_t i, help = 0, save = 0, telem = telem_enabled();
+
+	if(line->error){
+		printf("Bad command, ? for help\n");
+		return;
+	}
+	for(i = 0; i < line->n; i++){
+		const cmd_field *f = &line->f[i];
+		v = cmd_value(f);
+		if(f->key == '?' || f->key == 'h'){
+			help = 1;
+			continue;
+		}
+		if(f->key == 's'){
+			sched_report();
+			continue;
+		}
+		if(f->key == 'b'){
+			boot_report();
+			continue;
+		}
+		if(f->key == 'f'){
+			prot_report();
+			if(f->has_value && v == 0) prot_clear();
+			continue;
+		}
+		if(f->key == 'j'){
+			prof_report();
+			if(f->has_value && v == 0) prof_clear();
+			continue;
+		}
+		if(!f->has_value){
+			printf("'%c' needs a value\n", f->key);
+			return;
+		}
+		save |= f->key != 't';
+		switch(f->key){
+			case 'v':
+				target = target_in_range(v); //Ensures Vout_target does not go too low or too high
+				break;
+			case 'p':
+				nP = gain_in_range(v, KP_MIN, KP_MAX, KP_DEF);
+				break;
+			case 'i':
+				nI = gain_in_range(v, KI_MIN, KI_MAX, KI_DEF);
+				break;
+			case 'd':
+				nD = gain_in_range(v, KD_MIN, KD_MAX, KD_DEF);
+				break;
+			case 't':
+				telem = v != 0;
+				break;
+			default:
+				printf("Unknown key '%c', ? for help\n", f->key);
+				return;
+		}
+	}
+	if(help){
+		printf("v<volts>  target voltage, %d to %d\n", VSET_MIN, VOUTMAX);
+		printf("p<gain>   kP, 0.001 to 0.004\n");
+		printf("i<gain>   kI, 0.001 to 0.01\n");
+		printf("d<gain>   kD, 0.00005 to 0.00015\n");
+		printf("v, p, i and d are kept in EEPROM over a reset\n");
+		printf("t1 / t0   binary telemetry at %d Hz on / off\n", TELEM_HZ);
+		printf("s         task timing and overruns\n");
+		printf("b         boot timeline\n");
+		printf("f / f0    protection state and fault / and clear it\n");
+#if CTRL_SYNC
+		printf("j / j0    tick ISR latency and duration, control is in ADC_vect / and clear\n");
+#else
+		printf("j / j0    control ISR latency and duration / and clear\n");
+#endif
+		printf("Several per line, e.g. \"v12.5 p0.004 i0.005 d0.0001\"\n");
+	}
+	kP = nP;
+	kI = nI;
+	kD = nD;
+	pid g = ctrl;
+	pid_set_gains(&g, kP, kI, kD); //Rescales the new gains for the fixed-point loop, outside cli()
+	cli(); //The control ISR must not see half the new gains
+	Vout_target = target;
+	ctrl.kP = g.kP;
+	ctrl.kI = g.kI;
+	ctrl.kD = g.kD;
+	sei();
+	char t_s[FMT_BUF], p_s[FMT_BUF], i_s[FMT_BUF], d_s[FMT_BUF];
+	fmt_fixed(t_s, target, PID_VBITS, 2, 0);
+	fmt_dec(p_s, micro(nP), 6, 0);
+	fmt_dec(i_s, micro(nI), 6, 0);
+	fmt_dec(d_s, micro(nD), 6, 0);
+	printf("Vout_target = %s, kP = %s, kI = %s, kD = %s\n", t_s, p_s, i_s, d_s);
+	if(save){ //Written a byte at a time by the param task
+		params p = {target, micro(nP), micro(nI), micro(nD)};
+		params_save(&p);
+	}
+	telem_enable(telem); //After the reply, so it is not cut by frames
+}
 
+void led_light(void){
+	int16_t error = ctrl.error;
+	if(error < PID_V(0.5) && error > PID_V(-0.5)){
+	hal_gpio_write(HAL_PORTA, PA2, 1);
+	hal_gpio_write(HAL_PORTA, PA3, 0);//Turns Red LED off
+	}
+	else if (error > PID_V(0.5) || error < PID_V(-0.5)){
+	hal_gpio_write(HAL_PORTA, PA3, 1);	//Turns Red LED on
+	hal_gpio_write(HAL_PORTA, PA2, 0);
+	}
+}
 
-void init_pwm(void)
+double v_load(void)
 {
-    /* TIMER 2 */
-    DDRD |= _BV(PD6); /* PWM out */
-    DDRD |= _BV(PD7); /* inv. PWM out */
+     uint16_t adcread = adc_filtered();
     
-
-    TCCR2A = _BV(WGM20) | /* fast PWM/MAX */
-	     _BV(WGM21) | /* fast PWM/MAX */
-	     _BV(COM2A1); /* A output */
-    TCCR2B = _BV(CS20);   /* no prescaling */   
+     //printf("ADC=%4d", adcread);  
+ 
+     return (double) (adcread * ADCREF_V/ADC_READ_MAX);
 }
 
+
 void init_Interrupts(void){  //Idea for timer interrupt given to me by Christian Webb, cw8g19, majority of code taken from interrrupt lab
-	//Configures registers for TIMER1
-	TCCR1A = 0;				
-	TCCR1B |= _BV(WGM12);//sets mode 4
-	TCCR1B |= _BV(CS12) | _BV(CS10);//sets prescaler of 1
-	OCR1A = 59; 		 //Triggers at rate of 0.01 seconds
-	TIMSK1 |= _BV(OCIE1A);//Enables interrupt for TIMER1 
-	
-	
-	/*Configures interrupt to trigger on falling edge*/
-	EICRA |= _BV(ISC01);
-	EICRA |= _BV(ISC11);
-	
-	EIMSK |= _BV(INT0);
-	EIMSK |= _BV(INT1);
-	
-	
-	
-	UCSR0B |= _BV(RXCIE0); // Enables UART interrupt on receiving data
+	prof_init(HAL_TICK_TOP(CTRL_HZ));
+	sched_init(HAL_TICK_TOP(CTRL_HZ));	//TIMER1 CTC at clk/8, one control tick per ms
+	hal_ext_int_init();	//INT0/INT1 on falling edge
+	hal_uart_rx_int(1);	// Enables UART interrupt on receiving data
 }
 
 
@@ -371,9 +474,7 @@ void init_Interrupts(void){  //Idea for timer interrupt given to me by Christian
    a 100% duty cycle has no switching
    and consequently will not boost.  
 */
-void pwm_duty(double Duty) 
+void pwm_duty(uint16_t x) //8.8 OCR2A counts
 {
-    int16_t x = (int16_t)(Duty*PWM_DUTY_MAX);
-	
-	OCR2A = x;
+	hal_pwm_write16(x);
 }
@@ -0,0 +1,105 @@
+#include "ili934x.h"
+#include "chart.h"
+
+static void scroll_start(uint16_t row)
+{
+	write_cmd(VERTICAL_SCROLLING_START_ADDRESS);
+	write_data16(row);
+}
+
+/* Scrolls the oldest rows, the next to be drawn, to the bottom of the band */
+static void make_room(const chart *c, uint16_t rows)
+{
+	uint16_t n = c->bottom - c->top + 1;
+	scroll_start(c->top + (c->head - c->top + (rows < n ? rows : n)) % n);
+}
+
+/* gridx and gridt of 0 leave out that set of grid lines */
+void chart_init(chart *c, uint16_t top, uint16_t bottom, uint8_t gridx, uint8_t gridt)
+{
+	rectangle r = {0, display.width-1, top, bottom};
+	c->top = c->head = top;
+	c->bottom = bottom;
+	c->width = display.width;
+	c->last = 0;
+	c->gridx = gridx;
+	c->gridt = gridt;
+	c->tick = 0;
+	c->foreground = display.foreground;
+	c->background = display.background;
+	c->grid = c->foreground;
+
+	write_cmd(VERTICAL_SCROLLING_DEFINITION);
+	write_data16(top);
+	write_data16(bottom - top + 1);
+	write_data16(LCDHEIGHT - 1 - bottom);
+	scroll_start(top);
+	fill_rectangle(r, c->background);
+}
+
+/* Plots x, 0 at the left, joined to the previous sample by a span so
+ * steps stay visible.
+ */
+void chart_add(chart *c, uint16_t x)
+{
+	rectangle r = {0, c->width - 1, c->top, c->bottom};
+	if (x >= c->width) x = c->width - 1;
+	lcd_sync(r);
+	make_room(c, 1);
+	if (x < c->last)
+		chart_span(c, x, c->last);
+	else
+		chart_span(c, c->last, x);
+	c->last = x;
+}
+
+uint8_t chart_begin(const chart *c, uint16_t rows)
+{
+	rectangle r = {0, c->width - 1, c->top, c->bottom};
+	if (!lcd_clear(r))
+		return 0;
+	make_room(c, rows);
+	return 1;
+}
+
+/* One row with pixels lo to hi set, streamed left to right in a single
+ * window. lo above hi leaves the row blank apart from the grid.
+ */
+void chart_span(chart *c, uint16_t lo, uint16_t hi)
+{
+	uint16_t i, col;
+	uint8_t g = 0, row_grid;
+
+	row_grid = c->gridt && c->tick == 0;
+	if (++c->tick >= c->gridt) c->tick = 0;
+
+	write_cmd(COLUMN_ADDRESS_SET);
+	write_data16(0);
+	write_data16(c->width - 1);
+	write_cmd(PAGE_ADDRESS_SET);
+	write_data16(c->head);
+	write_data16(c->head);
+	write_cmd(MEMORY_WRITE);
+	for (i = 0; i < c->width; i++) {
+		if (i >= lo && i <= hi)
+			col = c->foreground;
+		else if (row_grid || (c->gridx && g == 0))
+			col = c->grid;
+		else
+			col = c->background;
+		write_data16(col);
+		if (++g >= c->gridx) g = 0;
+	}
+
+	if (++c->head > c->bottom) c->head = c->top;
+}
+
+/* Whole panel scrolling again, with the start back at row 0 */
+void chart_stop(void)
+{
+	write_cmd(VERTICAL_SCROLLING_DEFINITION);
+	write_data16(0);
+	write_data16(LCDHEIGHT);
+	write_data16(0);
+	scroll_start(0);
+}
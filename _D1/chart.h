@@ -0,0 +1,43 @@
+#ifndef CHART_H
+#define CHART_H
+
+#include <stdint.h>
+#include "lcd.h"
+
+/* Strip chart on the panel's hardware vertical scrolling.
+ *
+ * The panel scrolls along its 320 rows, so the chart is laid out for
+ * North: rows above top and below bottom stay fixed as header and
+ * footer, and each sample is one row of the band between them, with
+ * time running up the screen. chart_add() draws the newest row over the
+ * oldest one and moves the scroll start past it, so a sample costs one
+ * row of pixels however long the chart runs. chart_span() draws a row
+ * from its own extent, for callers such as wave.c that track that
+ * themselves, after chart_begin() has scrolled the band to make room for
+ * the rows to come. chart_stop() must be called before anything else is
+ * drawn across the band.
+ *
+ * Moving the scroll start while the panel is refreshing the band would
+ * shear it at the scan line, so under lcd_tear_sync() chart_begin() does
+ * nothing and returns 0 unless the scan is outside the band; the rows
+ * that then show at its bottom, stale, must be drawn before the scan gets
+ * there, which leaves most of a refresh. chart_add() waits for its turn.
+ */
+
+typedef struct {
+	uint16_t top, bottom;		/* scrolling band, in panel rows */
+	uint16_t head;			/* row the next sample is drawn on */
+	uint16_t width;			/* pixels per row */
+	uint16_t last;			/* x of the previous sample */
+	uint8_t gridx, gridt;		/* grid spacing in pixels and samples */
+	uint8_t tick;			/* samples since the last grid row */
+	uint16_t foreground, background, grid;
+} chart;
+
+void chart_init(chart *c, uint16_t top, uint16_t bottom, uint8_t gridx, uint8_t gridt);
+void chart_add(chart *c, uint16_t x);
+uint8_t chart_begin(const chart *c, uint16_t rows);
+void chart_span(chart *c, uint16_t lo, uint16_t hi);
+void chart_stop(void);
+
+#endif
@@ -0,0 +1,181 @@
+#include <ctype.h>
+#include "cmd.h"
+
+enum { ST_KEY, ST_SIGN, ST_MAG, ST_INT, ST_FRAC, ST_SKIP };
+
+/* Written by the RX interrupt only */
+static volatile uint8_t rx_head;
+static volatile uint8_t rx_overrun;
+static uint8_t rx_buf[CMD_RX_SIZE];
+
+/* Owned by the main loop */
+static uint8_t rx_tail;
+static uint8_t state = ST_KEY;
+static uint8_t digits, neg;
+static cmd_line cur;
+
+void cmd_rx(uint8_t c)
+{
+	uint8_t next = (rx_head + 1) & (CMD_RX_SIZE - 1);
+	if (next == rx_tail) {
+		rx_overrun = 1;		/* drop, the line is reported bad */
+		return;
+	}
+	rx_buf[rx_head] = c;
+	rx_head = next;
+}
+
+uint8_t cmd_overrun(void)
+{
+	uint8_t o = rx_overrun;
+	rx_overrun = 0;
+	return o;
+}
+
+static void bad(void)
+{
+	cur.error = 1;
+	state = ST_SKIP;
+}
+
+static void field_end(void)
+{
+	cmd_field *f = &cur.f[cur.n - 1];
+	if (state == ST_MAG || (state == ST_FRAC && !digits)) {
+		bad();			/* "-" or "." without digits */
+		return;
+	}
+	if (neg) f->mant = -f->mant;
+	state = ST_KEY;
+}
+
+static uint8_t line_end(cmd_line *line)
+{
+	if (state != ST_KEY && state != ST_SIGN && state != ST_SKIP)
+		field_end();
+	if (rx_overrun) {
+		rx_overrun = 0;
+		cur.error = 1;
+	}
+	*line = cur;
+	cur.n = 0;
+	cur.error = 0;
+	state = ST_KEY;
+	return line->n || line->error;
+}
+
+static uint8_t is_sep(uint8_t c)
+{
+	return c == ' ' || c == ',' || c == '\t';
+}
+
+/* One character of the line grammar:
+ *   line  = { sep } { field { sep } } eol
+ *   field = key [ "=" ] [ "-" | "+" ] [ digits ] [ "." digits ]
+ * A bare key (no value) may run straight into the next one, e.g. "?v12".
+ */
+static uint8_t parse(uint8_t c, cmd_line *line)
+{
+	cmd_field *f;
+
+	if (c == '\r' || c == '\n')
+		return line_end(line);
+
+	f = cur.n ? &cur.f[cur.n - 1] : 0;
+	switch (state) {
+	case ST_SKIP:
+		break;
+	case ST_KEY:
+		if (is_sep(c))
+			break;
+		if ((!isalpha(c) && c != '?') || cur.n == CMD_FIELDS) {
+			bad();
+			break;
+		}
+		f = &cur.f[cur.n++];
+		f->key = tolower(c);
+		f->has_value = 0;
+		f->mant = 0;
+		f->scale = 0;
+		digits = neg = 0;
+		state = ST_SIGN;
+		break;
+	case ST_SIGN:
+		if (c == ' ' || c == '=') {
+			break;
+		} else if (c == '-' || c == '+') {
+			neg = c == '-';
+			state = ST_MAG;
+		} else if (c == '.') {
+			state = ST_FRAC;
+		} else if (isdigit(c)) {
+			state = ST_INT;
+			return parse(c, line);
+		} else if (is_sep(c)) {
+			state = ST_KEY;
+		} else if (isalpha(c) || c == '?') {
+			state = ST_KEY;
+			return parse(c, line);
+		} else {
+			bad();
+		}
+		break;
+	case ST_MAG:
+		if (c == '.') {
+			state = ST_FRAC;
+		} else if (isdigit(c)) {
+			state = ST_INT;
+			return parse(c, line);
+		} else {
+			bad();
+		}
+		break;
+	case ST_INT:
+	case ST_FRAC:
+		if (isdigit(c)) {
+			if (++digits > CMD_DIGITS) {
+				bad();
+				break;
+			}
+			f->mant = f->mant*10 + (c - '0');
+			f->has_value = 1;
+			if (state == ST_FRAC) f->scale++;
+		} else if (c == '.' && state == ST_INT) {
+			state = ST_FRAC;
+		} else if (is_sep(c)) {
+			field_end();
+		} else if (isalpha(c) || c == '?') {
+			field_end();
+			if (state == ST_KEY)
+				return parse(c, line);
+		} else {
+			bad();
+		}
+		break;
+	}
+	return 0;
+}
+
+/* Run the parser over everything received so far. Returns 1 and fills
+ * line when a non-empty line has been completed; the rest of the queue
+ * is left for the next call.
+ */
+uint8_t cmd_poll(cmd_line *line)
+{
+	while (rx_tail != rx_head) {
+		uint8_t c = rx_buf[rx_tail];
+		rx_tail = (rx_tail + 1) & (CMD_RX_SIZE - 1);
+		if (parse(c, line))
+			return 1;
+	}
+	return 0;
+}
+
+double cmd_value(const cmd_field *f)
+{
+	double v = f->mant;
+	uint8_t s;
+	for (s = 0; s < f->scale; s++)
+		v /= 10.0;
+	return v;
+}
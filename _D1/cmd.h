@@ -0,0 +1,37 @@
+#ifndef CMD_H
+#define CMD_H
+
+#include <stdint.h>
+
+/* Operator commands over UART0.
+ *
+ * USART0_RX_vect only calls cmd_rx() to queue the byte. The main loop
+ * calls cmd_poll(), which runs the parser over the queued bytes and hands
+ * back a complete line. A line holds one or more fields, each a key
+ * letter and an optional signed decimal value, separated by spaces or
+ * commas, e.g. "v12.5 p0.0015 i0.00025". Exponents are not accepted.
+ */
+
+#define CMD_FIELDS	6
+#define CMD_DIGITS	8	/* digits per value, keeps the mantissa in 32 bits */
+#define CMD_RX_SIZE	64	/* power of two */
+
+typedef struct {
+	char key;		/* lower case letter or '?' */
+	uint8_t has_value;
+	int32_t mant;		/* value is mant / 10^scale */
+	uint8_t scale;
+} cmd_field;
+
+typedef struct {
+	uint8_t n;
+	uint8_t error;		/* bad character or too many digits/fields */
+	cmd_field f[CMD_FIELDS];
+} cmd_line;
+
+void cmd_rx(uint8_t c);
+uint8_t cmd_poll(cmd_line *line);
+uint8_t cmd_overrun(void);
+double cmd_value(const cmd_field *f);
+
+#endif
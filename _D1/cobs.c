@@ -0,0 +1,37 @@
+#include "cobs.h"
+
+/* Returns the encoded length, n + 1; out is not zero terminated */
+uint8_t cobs_encode(const uint8_t *in, uint8_t n, uint8_t *out)
+{
+	uint8_t *code = out++, len = 1, i;
+
+	for (i = 0; i < n; i++) {
+		if (in[i]) {
+			*out++ = in[i];
+			len++;
+		} else {
+			*code = len;
+			code = out++;
+			len = 1;
+		}
+	}
+	*code = len;
+	return n + 1;
+}
+
+/* Returns the decoded length, or 0 for a zero or overrunning code byte */
+uint8_t cobs_decode(const uint8_t *in, uint8_t n, uint8_t *out)
+{
+	uint8_t i = 0, j = 0, code, k;
+
+	while (i < n) {
+		code = in[i++];
+		if (code == 0 || i + code - 1 > n)
+			return 0;
+		for (k = 1; k < code; k++)
+			out[j++] = in[i++];
+		if (code < 0xff && i < n)
+			out[j++] = 0;
+	}
+	return j;
+}
@@ -0,0 +1,16 @@
+#ifndef COBS_H
+#define COBS_H
+
+#include <stdint.h>
+
+/* Consistent overhead byte stuffing: removes every zero from a packet of
+ * up to 254 bytes at the cost of one byte, so a zero can end each frame
+ * and a receiver resynchronises at the next one.
+ */
+
+#define COBS_MAX(n)	((n) + 1)
+
+uint8_t cobs_encode(const uint8_t *in, uint8_t n, uint8_t *out);
+uint8_t cobs_decode(const uint8_t *in, uint8_t n, uint8_t *out);	/* 0 when malformed */
+
+#endif
@@ -0,0 +1,48 @@
+#include "drawq.h"
+
+#define MASK	(DRAWQ_SIZE - 1)
+
+#if DRAWQ_SIZE > 256 || (DRAWQ_SIZE & MASK)
+#error DRAWQ_SIZE must be a power of two, at most 256
+#endif
+
+/* Keeps the compiler from moving slot accesses past head or tail */
+#define BARRIER()	__asm__ __volatile__("" ::: "memory")
+
+void drawq_init(drawq *q)
+{
+	q->head = q->tail = 0;
+	q->dropped = 0;
+}
+
+/* Producer side; returns 0 if the queue was full */
+uint8_t drawq_put(drawq *q, uint8_t op, uint8_t id, uint16_t x, uint16_t y)
+{
+	uint8_t h = q->head;
+	drawq_cmd *c;
+	if (((h + 1) & MASK) == q->tail) {
+		if (q->dropped != 0xFF) q->dropped++;
+		return 0;
+	}
+	c = &q->c[h];
+	c->op = op;
+	c->id = id;
+	c->x = x;
+	c->y = y;
+	BARRIER();
+	q->head = (h + 1) & MASK;	/* publish after the command is written */
+	return 1;
+}
+
+/* Consumer side; returns 0 if there was nothing queued */
+uint8_t drawq_get(drawq *q, drawq_cmd *c)
+{
+	uint8_t t = q->tail;
+	if (t == q->head)
+		return 0;
+	BARRIER();
+	*c = q->c[t];
+	BARRIER();
+	q->tail = (t + 1) & MASK;	/* the slot is free once copied */
+	return 1;
+}
@@ -0,0 +1,36 @@
+#ifndef DRAWQ_H
+#define DRAWQ_H
+
+#include <stdint.h>
+
+/* Draw command queue from interrupt handlers to the main loop.
+ *
+ * ISRs must not touch the LCD: a window set by the main loop would be cut
+ * by theirs. Instead they drawq_put() a small command saying what changed,
+ * and the main loop drawq_get()s them between its own drawing, where it
+ * can fold several into one repaint. One producer context (interrupts
+ * that do not nest) and one consumer: head is only written by the
+ * producer and tail by the consumer, both single bytes, so neither side
+ * disables interrupts. A command that does not fit is dropped and
+ * counted; give commands absolute values, so a later one repairs it.
+ */
+
+#define DRAWQ_SIZE	16	/* power of two, at most 256; holds one less */
+
+typedef struct {
+	uint8_t op;		/* the caller's command code */
+	uint8_t id;		/* which object, for the caller */
+	uint16_t x, y;
+} drawq_cmd;
+
+typedef struct {
+	drawq_cmd c[DRAWQ_SIZE];
+	volatile uint8_t head, tail;
+	volatile uint8_t dropped;
+} drawq;
+
+void drawq_init(drawq *q);
+uint8_t drawq_put(drawq *q, uint8_t op, uint8_t id, uint16_t x, uint16_t y);
+uint8_t drawq_get(drawq *q, drawq_cmd *c);
+
+#endif
@@ -3,9 +3,8 @@
 // 
 //          - F_CPU must be defined to match the clock frequency
 //
-//          - Compile with the options to enable floating point
-//            numbers in printf(): 
-//               -Wl,-u,vfprintf -lprintf_flt -lm
+//          - Numbers are formatted by fmt.c, so the floating point
+//            printf (-u vfprintf -lprintf_flt) is not needed
 //
 //          - Pin assignment: 
 //            | Port | Pin | Use                         |
@@ -16,12 +15,12 @@
 //            | D    | PD7 | PWM out to drive MOSFET     |
 //
 
- // avr-gcc -u vfprintf -lprintf_flt -lm -mmcu=atmega644p -DF_CPU=12000000 -Wall -Os embedded_boost.c -o boost.elf
+ // avr-gcc -mmcu=atmega644p -DF_CPU=12000000 -Wall -Os embedded_boost.c -o boost.elf -L. -llcd -lm
  //avr-objcopy -O ihex boost.elf boost.hex
  //avrdude -c usbasp -p m644p -U flash:w:boost.hex
  
- //avr-gcc -u vfprintf -lprintf_flt -lm -mmcu=atmega644p -DF_CPU=12000000 -Wall -Os -c embedded_boost.c -o boost.o
- //avr-gcc -mmcu=atmega644p -u vfprintf -lprintf_flt -lm -L.\ -o boost.exe boost.o -llcd
+ //avr-gcc -mmcu=atmega644p -DF_CPU=12000000 -Wall -Os -c embedded_boost.c -o boost.o
+ //avr-gcc -mmcu=atmega644p -L.\ -o boost.exe boost.o -llcd -lm
  //avr-objcopy -O ihex boost.exe boost.hex
  //avrdude -c usbasp -p m644p -U flash:w:boost.hex
  
@@ -34,9 +33,19 @@
 #include <stdlib.h>
 
 #include "lcd.h"
+#include "pid.h"
+#include "adc.h"
+#include "hal.h"
+#include "cmd.h"
+#include "telem.h"
+#include "fmt.h"
+#include "field.h"
+#include "chart.h"
+#include "wave.h"
+#include "prot.h"
 
 #define DELAY_MS      100
-#define BDRATE_BAUD  9600 //speed of the code
+#define BDRATE_BAUD  57600 //U2X, 0.16% fast; telemetry takes 2.5 of its 5.8 kB/s
 
 #define ADCREF_V     3.3 //reference voltage
 #define ADCMAXREAD   1023   /* 10 bit ADC */
@@ -46,50 +55,48 @@
 */
 #define PWM_DUTY_MAX 240    /* 94% duty cycle */
 
-#define MAXV 13
+#define MAXV 15   /* highest target, for v and the INT0 steps */
+#define OVP_V 16.5 /* PWM cut in the ADC ISR above this (prot.h), clear of MAXV */
 
-#define MINV 2
+#define MINV 2    /* lowest target, for v and the INT1 steps */
 
-volatile int delay =0;
-
-volatile double error = 0.0;
-
-volatile double errorPrev = 0.0;
-
-volatile double errorInt = 0.0;
-
-volatile double errorDiff = 0.0;
-
-volatile double dutyCycle = 0.6;
-
-volatile uint8_t targetVoltage = 10.0; 
+/* Portrait layout: fixed header and footer, the chart scrolls between */
+#define CHART_TOP    22
+#define CHART_BOTTOM 299
+#define CHART_ROWS   (CHART_BOTTOM - CHART_TOP + 1)
 
-volatile char buffer[0];
+/* Trace samples are 8-bit, 1/16 V from 0 to 16 V */
+#define TRACE_BITS   4
+#define TRACE_DECIM  4    /* control ticks per chart row */
 
-volatile char inp0[0]; 
-
-volatile char inp1[0];
+volatile int delay =0;
 
-volatile char temp2[0]; 
+pid ctrl; //fixed-point PID state, updated by TIMER1_COMPA_vect
+const prot_policy ovp = {20, 40, 3, 400}; //195 Hz ticks: 0.1 s off, 0.2 s soft start
 
-volatile int checknr;
+volatile int16_t targetVoltage = PID_VI(10); //Q5.10 volts
+volatile uint8_t telem_due; //Set each tick, send_telem() clears it
 
-void init_stdio2uart0(void);
-int uputchar0(char c, FILE *stream);
-int ugetchar0(FILE *stream);
 		
-void init_adc(void);
 double v_load(void);
 
 void init_pwm(void);
 
-void pwmDuty(double dutyCycle);
+void pwmDuty(uint8_t x);
 
 void writeText(int x, int y, char *str);
 void init_counter(void);
-void grid(void);
+void labels(void);
+void apply_cmd(const cmd_line *line);
+void send_telem(void);
+
+uint8_t pwmGlobal = 0;
 
-double pwmGlobal = 0;
+field voltageF, targetF, kPF, kIF, kDF; //only changed characters are redrawn
+chart trend; //Vout against time, one row per TRACE_DECIM ticks
+field scaleF; //Vout at the chart's left and right edges
+wave trace; //min/max of every tick, filled by TIMER1_COMPA_vect
+wave_bucket history[CHART_ROWS];
 
 volatile double kP=0.0017;
 volatile double kI=0.02;
@@ -97,116 +104,73 @@ volatile double kD=0.0001;
 
 ISR(INT1_vect, ISR_NOBLOCK){
 
-	if((v_load()/0.176)>2){
-		targetVoltage = targetVoltage - 0.5;	
+	if(targetVoltage - PID_V(0.5) >= PID_VI(MINV)){ //The target, not Vout, which lags it and may be off
+		targetVoltage -= PID_V(0.5);	
 	}	else {
-		targetVoltage = 5;
+		targetVoltage = PID_VI(5);
 	}
 }
 
 ISR(INT0_vect, ISR_NOBLOCK){
 	
-	if((v_load()/0.176)<15){
-		targetVoltage = targetVoltage + 0.5;
+	if(targetVoltage + PID_V(0.5) <= PID_VI(MAXV)){ //The target, not Vout, which lags it and may be off
+		targetVoltage += PID_V(0.5);
 	}	else {
-		targetVoltage = 5;
+		targetVoltage = PID_VI(5);
 	}
 }
 
 ISR(TIMER1_COMPA_vect, ISR_NOBLOCK){
-	error = ((v_load()/0.176) - targetVoltage);
-    errorInt = ((error + errorInt)*0.01);
-    errorDiff = ((error - errorPrev)/0.01);
-    dutyCycle = dutyCycle - (error*kP + errorInt*kI + errorDiff*kD);
-	if(dutyCycle>0.95 || dutyCycle<0.1){
-		dutyCycle = 0.5;
-	}
-	pwmDuty(dutyCycle);
-    errorPrev = error;
-	if(v_load()>13){
-		pwmDuty(0);
-	}
+	uint16_t adc = adc_latest();
+	int16_t v = PID_ADCX_TO_V(adc, ADC_OSR_BITS);
+	ctrl.target = targetVoltage;
+	pid_update(&ctrl, v);
+	v >>= PID_VBITS - TRACE_BITS;
+	wave_sample(&trace, v > 0xFF ? 0xFF : v);
+	prot_tick();
+	if(!prot_running()) ctrl.duty = ctrl.duty_min;
+	pwmDuty(prot_limit((uint16_t)pid_pwm(&ctrl, PWM_DUTY_MAX) << 8) >> 8);
+	telem_due = 1; //Framed and queued by the main loop, not in here
+}
+
+/* Binary record when enabled, see telem.h, from a snapshot of the loop */
+void send_telem(void){
+	pid snap;
+	uint16_t adc;
+	if(!telem_due) return;
+	telem_due = 0;
+	if(!telem_enabled()) return;
+	cli();
+	snap = ctrl;
+	adc = adc_latest();
+	sei();
+	telem_record(adc, &snap);
 }
 
 //The UART was completed in association with Christian Esterhuise
 
 ISR(USART0_RX_vect){
-	scanf("%c", buffer);
-	printf("\n\n\r To alter desired voltage, it's key 1.");
-	printf("\n\r To alter P weighting, it's key 2.");
-	printf("\n\r To alter I weighting, it's key 3.");
-	printf("\n\r To alter D weighting, it's key 4.");
-	printf("\n\r To alter delay it's key 5");
-	_delay_ms(100);
-	fscanf(stdin, "%c", temp2);
-	checknr = atoi(temp2);
-	printf("\n %i \n", checknr);
-	switch(checknr){
-		case 1:
-			printf("\n\rPlease enter your new voltage as two number keystrokes, they are added together.");
-			fscanf(stdin, "%c", inp1);
-			_delay_ms(200); 
-			fscanf(stdin, "%c", inp0);
-			//printf("%d",inp0);
-			targetVoltage = (atoi(inp0)+atoi(inp1));
-			if (targetVoltage > 14 || targetVoltage < 2) targetVoltage = 10;
-			printf("\nCompleted\n");
-			break;
-		
-		case 2:
-			printf("\n\rPlease enter your new value for kP, the number gets added then multiplied by a constant of 1e-4");
-			fscanf(stdin, "%c", inp0);
-			_delay_ms(200); 
-			fscanf(stdin, "%c", inp1);
-			kP = ((atoi(inp0)+atoi(inp1))*1e-4);
-			if(kP > 0.003 || kP < 0.0005) kP = 0.002;
-			printf("\nCompleted\n");
-			break;
-		case 3:
-			printf("\n\rPlease enter your new value for kD, the number gets added then multiplied by a constant of 1e-4");
-			fscanf(stdin, "%c", inp0);
-			_delay_ms(200); 
-			fscanf(stdin, "%c", inp1);
-			kD = ((atoi(inp0)+atoi(inp1))*1e-4);
-			if(kD > 0.002   || kP < 0.0001) kD = 0.02;
-			printf("\nCompleted\n");
-			break;
-		case 4:
-			printf("\n\rPlease enter your new value for kI, the number gets added then multiplied by a constant of 1e-5");
-			fscanf(stdin, "%c", inp0);
-			_delay_ms(200); 
-			fscanf(stdin, "%c", inp1);
-			kI = ((atoi(inp0)+atoi(inp1))*1e-5);
-			printf("\nCompleted\n");
-			break;
-			if(kI > 0.0008 || kI < 0.00005) kI = 0.0001;
-		case 5:
-			printf("\n\rPlease enter your new delay value, this is multiplied by 100");
-			fscanf(stdin, "%c", inp0);
-			_delay_ms(200); 
-			delay = ((atoi(inp0)+atoi(inp1))*10);
-			printf("\nCompleted\n");
-			break;
-		default:
-			printf("\n Please enter a valid number\n");
-	}
-	_delay_ms(300);
+	cmd_rx(UDR0);
 }
 
 int main(void)
 {
-	uint16_t cnt =0;
-    
 	_delay_ms(delay);
 	
-	init_stdio2uart0();
+	hal_uart_init(BDRATE_BAUD);
+	hal_stdio_init();
 	init_pwm(); 
-	init_adc();
+	adc_init(0);
+	prot_init(&ovp, PROT_ADC(OVP_V));
+	pid_init(&ctrl, 0.01, 0.5, 0.1, 0.95);
+	ctrl.duty = PID_DUTY(0.6);
+	pid_set_gains(&ctrl, kP, kI, kD);
 	init_counter();
 	init_lcd();//initilises the lcd 
-	clear_screen();//clears screen
 	
-	set_orientation(East);
+	set_orientation(North);
+	clear_screen();//clears screen
+	lcd_tear_sync(1);//chart rows and fields go out behind the panel's scan
 	
 	EIMSK |= _BV(INT0);
 	EIMSK |= _BV(INT1);
@@ -215,110 +179,126 @@ int main(void)
 	
 	//DDRC |= _BV(0);
 	//DDRC |= _BV(1);
-	char voltageS0[10];
-	char voltageS1[10];
-	char errorW[10];
-	char errorWI[10];
-	char errorWD[10];
-	uint16_t timeX = 0;
-	uint16_t timeX2 =0;
-	uint8_t offset = 20;
-	uint8_t height = height = LCDWIDTH - offset;
-	uint8_t voltageY = 10;
-	//int xPos = 0;
-	rectangle clearer = {0,0,(voltageY+offset),offset};
-	rectangle point = {timeX, timeX, (voltageY+offset), (voltageY+offset)};
-	rectangle upBar = {0,display.width, 10, 11};
-	rectangle downBar = {0, display.width, 227, 228};
+	char text[FMT_BUF];
+	rectangle upBar = {0, display.width-1, CHART_TOP-2, CHART_TOP-1};
+	rectangle downBar = {0, display.width-1, CHART_BOTTOM+1, CHART_BOTTOM+2};
 	fill_rectangle(upBar, WHITE);
 	fill_rectangle(downBar, WHITE);
-	clearer.top = height;
-	clearer.bottom = offset;
+	chart_init(&trend, CHART_TOP, CHART_BOTTOM, display.width/8, 32);
+	trend.foreground = PURPLE;
+	trend.grid = WHITE;
+	wave_init(&trace, history, CHART_ROWS, TRACE_DECIM);
+	field_init(&scaleF, 180, 10, 10);
+	field_init(&voltageF, 100, 0, 6);
+	field_init(&targetF, 100, 10, 4);
+	field_init(&kPF, 20, 306, 7);
+	field_init(&kIF, 90, 306, 7);
+	field_init(&kDF, 160, 306, 7);
+	labels();
 	sei();
-	grid();
 
 	for(;;) {	    
+		cmd_line line;
+		if(cmd_poll(&line)) apply_cmd(&line);
+		send_telem();
 	
-	    point.right = timeX;
-		point.left = timeX;
-		point.top = voltageY;
-		point.bottom = voltageY;
-		
-		//if(timeX>LCDHEIGHT)timeX=-1;
-		if(timeX>display.width){timeX2=0;}
-		clearer.right = timeX2;
-		clearer.left = timeX2;
-		
-		fill_rectangle(clearer, BLACK);
-		//_delay_ms(10);
-		fill_rectangle(point, PURPLE);
-		
-		double voltage = v_load()/0.176;
+		if(wave_draw(&trace, &trend)){
+			uint8_t n = fmt_fixed(text, trace.lo, TRACE_BITS, 1, 0);
+			text[n++] = '-';
+			n += fmt_fixed(text + n, trace.hi, TRACE_BITS, 1, 0);
+			text[n++] = 'V';
+			text[n] = '\0';
+			field_set(&scaleF, text);
+		}
+		int16_t vout = PID_ADCX_TO_V(adc_filtered(), ADC_OSR_BITS);
 		
 		/* printf( "%04d:  ", cnt );
 	    printf( " PWM = %4.3f -->  %5.3f V --> Boosted Voltage %5.3f --> Target voltage %5u     error%5.2f     errorInt%5.2f    errorDiff%5.2f  timeX = %5u\r\n", pwmGlobal ,v_load(),voltage, targetVoltage, error, errorInt, errorDiff, timeX); */
 	    //_delay_ms(DELAY_MS);
-		sprintf(voltageS0, "%f", voltage);
-		sprintf(voltageS1, "%i", targetVoltage);
-		sprintf(errorW, "%.5f", kP);
-		sprintf(errorWI, "%.5f", kI);
-		sprintf(errorWD, "%.5f", kD);
-		
-		writeText(0, 0 , "Boosted Voltage:");
-		writeText(100, 0, voltageS0);
-		writeText(200, 0 ,"Desired Voltage: ");
-		writeText(300, 0, voltageS1);
-		display_string(" ");
-		//writeText(200, 0 ,"Desired Voltage:        ");
-		
-		writeText(0, 230 ,"P = ");
-	    writeText(20, 230, errorW);
-		
-		writeText(70,230, "I = ");
-		writeText(90,230, errorWI);
-		
-		writeText(140,230, "D = ");
-		writeText(160,230, errorWD);
-		
-		voltageY = (uint8_t)(display.height-((voltage/MAXV)*height));
-		timeX = (uint16_t)(display.width-(cnt % display.width));
-		timeX2 = timeX;
-		cnt++;
-		
-	if((cnt%display.width) == 0){
-		clear_screen();
-		fill_rectangle(upBar, WHITE);
-		fill_rectangle(downBar, WHITE);
-		grid();
-		};
-		
+		fmt_fixed(text, vout, PID_VBITS, 3, 6);
+		field_set(&voltageF, text);
+		fmt_fixed(text, targetVoltage, PID_VBITS, 1, 4);
+		field_set(&targetF, text);
+		fmt_dec(text, (int32_t)(kP*1e5 + 0.5), 5, 7);
+		field_set(&kPF, text);
+		fmt_dec(text, (int32_t)(kI*1e5 + 0.5), 5, 7);
+		field_set(&kIF, text);
+		fmt_dec(text, (int32_t)(kD*1e5 + 0.5), 5, 7);
+		field_set(&kDF, text);
 	}
 }
 
-void grid(void){
-	rectangle z ={1,1,11, 228};
-	rectangle a ={32,32,11, 228};
-	rectangle b ={64,64,11, 228};
-	rectangle c ={96,96,11, 228};
-	rectangle d ={128,128,11, 228};
-	rectangle e ={160,160,11, 228};
-	rectangle f ={192,192,11, 228};
-	rectangle g ={224,224,11, 228};
-	rectangle h ={256,256,11, 228};
-	rectangle i ={288,288,11, 228};
-	rectangle j ={319,319,11, 228};
-	fill_rectangle(z, WHITE);
-	fill_rectangle(a, WHITE);
-	fill_rectangle(b, WHITE);
-	fill_rectangle(c, WHITE);
-	fill_rectangle(d, WHITE);
-	fill_rectangle(e, WHITE);
-	fill_rectangle(f, WHITE);
-	fill_rectangle(g, WHITE);
-	fill_rectangle(h, WHITE);
-	fill_rectangle(i, WHITE);
-	fill_rectangle(j, WHITE);
-	
+/* Every field of the line is applied, or none if it is bad */
+void apply_cmd(const cmd_line *line){
+	double v, nP = kP, nI = kI, nD = kD;
+	int16_t target = targetVoltage;
+	uint8_t i, telem = telem_enabled();
+
+	if(line->error){
+		printf("\n Bad command, ? for help\n");
+		return;
+	}
+	for(i = 0; i < line->n; i++){
+		const cmd_field *f = &line->f[i];
+		v = cmd_value(f);
+		if(f->key == '?'){
+			printf("\n v<volts %d-%d> p<kP 0.0005-0.003> i<kI 0-1> d<kD 0.0001-0.002> t<0/1 telemetry>", MINV, MAXV);
+			printf("\n e.g. \"v12.5 p0.0017 i0.02 d0.0001\", out of range gives the default\n");
+			continue;
+		}
+		if(!f->has_value){
+			printf("\n '%c' needs a value\n", f->key);
+			return;
+		}
+		switch(f->key){
+			case 'v':
+				target = (v > MAXV || v < MINV) ? PID_VI(10) : PID_V(v);
+				break;
+			case 'p':
+				nP = (v > 0.003 || v < 0.0005) ? 0.002 : v;
+				break;
+			case 'i':
+				nI = (v > 1 || v < 0) ? 0.02 : v; //Above about 2 the loop oscillates
+				break;
+			case 'd':
+				nD = (v > 0.002 || v < 0.0001) ? 0.0001 : v;
+				break;
+			case 't':
+				telem = v != 0;
+				break;
+			default:
+				printf("\n Unknown key '%c'\n", f->key);
+				return;
+		}
+	}
+	kP = nP;
+	kI = nI;
+	kD = nD;
+	pid g = ctrl;
+	pid_set_gains(&g, kP, kI, kD);
+	cli();
+	targetVoltage = target;
+	ctrl.kP = g.kP;
+	ctrl.kI = g.kI;
+	ctrl.kD = g.kD;
+	sei();
+	printf("\nCompleted\n");
+	telem_enable(telem);
+}
+
+/* Static text in the fixed header and footer, drawn once at start up */
+void labels(void){
+	writeText(0, 0 , "Boosted Voltage:");
+	writeText(0, 10 ,"Desired Voltage:");
+	writeText(0, 306 ,"P = ");
+	writeText(70,306, "I = ");
+	writeText(140,306, "D = ");
+	field_invalidate(&voltageF);
+	field_invalidate(&targetF);
+	field_invalidate(&kPF);
+	field_invalidate(&kIF);
+	field_invalidate(&kDF);
+	field_invalidate(&scaleF);
 }
 
 void writeText(int x, int y, char *str){
@@ -329,55 +309,6 @@ void writeText(int x, int y, char *str){
 	
 }
 
-int uputchar0(char c, FILE *stream)
-{
-	if (c == '\n') uputchar0('\r', stream);
-	while (!(UCSR0A & _BV(UDRE0)));
-	UDR0 = c;
-	return c;
-}
-
-int ugetchar0(FILE *stream)
-{
-	while(!(UCSR0A & _BV(RXC0)));
-	return UDR0;
-}
-
-void init_stdio2uart0(void)
-{
-	/* Configure UART0 baud rate, one start bit, 8-bit, no parity and one stop bit */
-	UBRR0H = (F_CPU/(BDRATE_BAUD*16L)-1) >> 8;
-	UBRR0L = (F_CPU/(BDRATE_BAUD*16L)-1);
-	UCSR0B = _BV(RXEN0) | _BV(TXEN0);
-	UCSR0C = _BV(UCSZ00) | _BV(UCSZ01);
-
-	/* Setup new streams for input and output */
-	static FILE uout = FDEV_SETUP_STREAM(uputchar0, NULL, _FDEV_SETUP_WRITE);
-	static FILE uin = FDEV_SETUP_STREAM(NULL, ugetchar0, _FDEV_SETUP_READ);
-
-	/* Redirect all standard streams to UART0 */
-	stdout = &uout;
-	stderr = &uout;
-	stdin = &uin;
-	
-	// Turns on interrupt receive flag
-}
-
-void init_adc (void)
-{
-    /* REFSx = 0 : Select AREF as reference
-     * ADLAR = 0 : Right shift result
-     *  MUXx = 0 : Default to channel 0
-     */
-    ADMUX = 0x00;
-    /*  ADEN = 1 : Enable the ADC
-     * ADPS2 = 1 : Configure ADC prescaler
-     * ADPS1 = 1 : F_ADC = F_CPU / 64
-     * ADPS0 = 0 :       = 187.5 kHz
-     */
-    ADCSRA = _BV(ADEN) | _BV(ADPS2) | _BV(ADPS1);
-}
-
 void init_counter(void){
 	
 	//initilise the counter in fast pwm mode
@@ -396,17 +327,11 @@ void init_counter(void){
 
 double v_load(void)
 {
-     uint16_t adcread;
-         
-     /* Start single conversion */
-     ADCSRA |= _BV ( ADSC );
-     /* Wait for conversion to complete */
-     while ( ADCSRA & _BV ( ADSC ) );
-     adcread = ADC;
+     uint16_t adcread = adc_filtered();
     
      //printf("ADC=%4d", adcread);  
  
-     return (double) (adcread * ADCREF_V/ADCMAXREAD);
+     return (double) (adcread * ADCREF_V/ADC_READ_MAX);
 }
 
 void init_pwm(void)
@@ -429,10 +354,8 @@ void init_pwm(void)
    and consequently will not boost.  
 */
 
-void pwmDuty(double dutyCycle) 
+void pwmDuty(uint8_t x) 
 {
-    uint8_t x = (uint8_t)(PWM_DUTY_MAX*dutyCycle);
-    
     //printf("PWM=%4u  ==>  ", x);  
 
     OCR2A = x;
@@ -0,0 +1,56 @@
+#include "field.h"
+
+/* Cell width of a display_char() glyph, including its spacing column */
+#define CELL_W	6
+
+void field_label(uint16_t x, uint16_t y, char *text)
+{
+	display.x = x;
+	display.y = y;
+	display_string(text);
+}
+
+void field_init(field *f, uint16_t x, uint16_t y, uint8_t width)
+{
+	f->x = x;
+	f->y = y;
+	f->width = width > FIELD_MAX ? FIELD_MAX : width;
+	f->foreground = display.foreground;
+	f->background = display.background;
+	field_invalidate(f);
+}
+
+/* Nothing printable matches '\0', so every cell is drawn next time */
+void field_invalidate(field *f)
+{
+	uint8_t i;
+	for (i = 0; i < f->width; i++)
+		f->shown[i] = '\0';
+}
+
+/* s is cut or padded with spaces to the field width */
+void field_set(field *f, const char *s)
+{
+	uint16_t fg = display.foreground, bg = display.background;
+	rectangle r = {f->x, f->x + f->width*CELL_W - 1, f->y, f->y + 7};
+	uint8_t i, synced = 0;
+	char c;
+
+	display.foreground = f->foreground;
+	display.background = f->background;
+	for (i = 0; i < f->width; i++) {
+		c = *s ? *s++ : ' ';
+		if (c == f->shown[i])
+			continue;
+		if (!synced) {
+			lcd_sync(r);	/* once, for every cell that changes */
+			synced = 1;
+		}
+		display.x = f->x + i*CELL_W;
+		display.y = f->y;
+		display_char(c);
+		f->shown[i] = c;
+	}
+	display.foreground = fg;
+	display.background = bg;
+}
@@ -0,0 +1,31 @@
+#ifndef FIELD_H
+#define FIELD_H
+
+#include <stdint.h>
+#include "lcd.h"
+
+/* Retained text on the LCD.
+ *
+ * A label is static text drawn once with field_label(). A field is a
+ * fixed number of character cells that remembers what the panel shows;
+ * field_set() repaints only the cells whose character changed, so a
+ * steady reading costs no bus traffic at all. Anything that paints over
+ * a field (clear_screen() for one) must call field_invalidate() on it.
+ * The changed cells go out together, after lcd_sync() on the field.
+ */
+
+#define FIELD_MAX	16	/* characters per field */
+
+typedef struct {
+	uint16_t x, y;
+	uint8_t width;
+	uint16_t foreground, background;
+	char shown[FIELD_MAX];
+} field;
+
+void field_label(uint16_t x, uint16_t y, char *text);
+void field_init(field *f, uint16_t x, uint16_t y, uint8_t width);
+void field_set(field *f, const char *s);
+void field_invalidate(field *f);
+
+#endif
@@ -0,0 +1,56 @@
+#include "fmt.h"
+
+static const uint16_t pow10_tab[FMT_MAXDEC + 1] = {1, 10, 100, 1000, 10000};
+
+/* Digits of u with a point before the last decimals digits, sign first */
+static uint8_t put(char *buf, uint32_t u, uint8_t neg, uint8_t decimals, uint8_t width)
+{
+	char tmp[FMT_BUF];
+	uint8_t n = 0, len, i;
+
+	do {
+		if (n == decimals && decimals)
+			tmp[n++] = '.';
+		tmp[n++] = '0' + u % 10;
+		u /= 10;
+	} while (u || n <= decimals);
+	if (neg)
+		tmp[n++] = '-';
+
+	len = n < width ? width : n;
+	for (i = 0; i < len - n; i++)
+		buf[i] = ' ';
+	while (n)
+		buf[i++] = tmp[--n];
+	buf[i] = '\0';
+	return len;
+}
+
+uint8_t fmt_int(char *buf, int32_t x, uint8_t width)
+{
+	return fmt_dec(buf, x, 0, width);
+}
+
+/* x is the value times 10^decimals */
+uint8_t fmt_dec(char *buf, int32_t x, uint8_t decimals, uint8_t width)
+{
+	uint32_t u = x < 0 ? -(uint32_t)x : (uint32_t)x;
+	return put(buf, u, x < 0, decimals, width);
+}
+
+/* x is the value times 2^frac_bits, frac_bits at most 16 */
+uint8_t fmt_fixed(char *buf, int32_t x, uint8_t frac_bits, uint8_t decimals, uint8_t width)
+{
+	uint32_t u = x < 0 ? -(uint32_t)x : (uint32_t)x;
+	uint32_t ip = u >> frac_bits, fp = u & ((1UL << frac_bits) - 1);
+
+	if (decimals > FMT_MAXDEC)
+		decimals = FMT_MAXDEC;
+	/* Fraction to decimals digits, rounded, carrying into the integer */
+	fp = (fp*pow10_tab[decimals] + ((1UL << frac_bits) >> 1)) >> frac_bits;
+	if (fp >= pow10_tab[decimals]) {
+		ip++;
+		fp -= pow10_tab[decimals];
+	}
+	return put(buf, ip*pow10_tab[decimals] + fp, x < 0 && (ip || fp), decimals, width);
+}
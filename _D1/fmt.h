@@ -0,0 +1,26 @@
+#ifndef FMT_H
+#define FMT_H
+
+#include <stdint.h>
+
+/* Number formatting without stdio, floats or heap, for the LCD and UART.
+ *
+ * Each function writes a NUL terminated string right aligned in width
+ * characters (wider results are not cut) and returns its length, so buf
+ * needs max(width, digits + sign + point) + 1 bytes; FMT_BUF covers any
+ * int32_t. Rounding is half away from zero. The value times 10^decimals
+ * must fit in 32 bits.
+ *
+ *   fmt_int(b, -42, 5)                  "  -42"
+ *   fmt_dec(b, 15, 4, 0)                "0.0015"   15 / 10^4
+ *   fmt_fixed(b, PID_V(9.87), 10, 2, 6) "  9.87"   Q10 to 2 decimals
+ */
+
+#define FMT_BUF		14
+#define FMT_MAXDEC	4	/* fmt_fixed() decimals, keeps it in 32 bits */
+
+uint8_t fmt_int(char *buf, int32_t x, uint8_t width);
+uint8_t fmt_dec(char *buf, int32_t x, uint8_t decimals, uint8_t width);
+uint8_t fmt_fixed(char *buf, int32_t x, uint8_t frac_bits, uint8_t decimals, uint8_t width);
+
+#endif
@@ -0,0 +1,120 @@
+/*   fmt_bench.c
+ *
+ *   Cycles per number conversion, sprintf("%lf") against fmt_fixed()
+ *   and fmt_dec(), on the values display_lcd() shows. Timer1 runs
+ *   without a prescaler so TCNT1 counts CPU cycles directly.
+ *
+ *   This program links the float printf for comparison. The flash it
+ *   costs is the difference in avr-size text between boost.c linked with
+ *   and without -Wl,-u,vfprintf -lprintf_flt.
+ *
+ *   avr-gcc -mmcu=atmega644p -DF_CPU=12000000 -Wall -Os -c fmt_bench.c -o fmt_bench.o
+ *   avr-gcc -mmcu=atmega644p -Wl,-u,vfprintf -L. -o fmt_bench.elf fmt_bench.o -llcd -lprintf_flt -lm
+ */
+
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "pid.h"
+#include "fmt.h"
+
+#define BDRATE_BAUD  9600
+#define RUNS         64
+
+volatile int16_t sample;
+char buf[20];
+
+int uputchar0(char c, FILE *stream)
+{
+	if (c == '\n') uputchar0('\r', stream);
+	while (!(UCSR0A & _BV(UDRE0)));
+	UDR0 = c;
+	return c;
+}
+
+void init_stdio2uart0(void)
+{
+	UBRR0H = (F_CPU/(BDRATE_BAUD*16L)-1) >> 8;
+	UBRR0L = (F_CPU/(BDRATE_BAUD*16L)-1);
+	UCSR0B = _BV(TXEN0);
+	UCSR0C = _BV(UCSZ00) | _BV(UCSZ01);
+
+	static FILE uout = FDEV_SETUP_STREAM(uputchar0, NULL, _FDEV_SETUP_WRITE);
+	stdout = &uout;
+}
+
+/* Old display_lcd(): Q10 volts through a double */
+void float_volts(void)
+{
+	sprintf(buf, "%lf", (double)sample/(1<<PID_VBITS));
+}
+
+void fixed_volts(void)
+{
+	fmt_fixed(buf, sample, PID_VBITS, 3, 7);
+}
+
+/* A gain, as a double and in millionths */
+void float_gain(void)
+{
+	sprintf(buf, "%lf", sample*1e-7);
+}
+
+void fixed_gain(void)
+{
+	fmt_dec(buf, sample/10, 6, 8);
+}
+
+void int_printf(void)
+{
+	sprintf(buf, "%d", sample);
+}
+
+void int_fmt(void)
+{
+	fmt_int(buf, sample, 0);
+}
+
+uint16_t time_conv(void (*conv)(void), uint16_t *worst)
+{
+	uint32_t total = 0;
+	uint16_t i, t0, t;
+	*worst = 0;
+	for (i = 0; i < RUNS; i++) {
+		sample = PID_V(-3.0) + i*421;	/* -3V to about 23V */
+		cli();
+		t0 = TCNT1;
+		conv();
+		t = TCNT1 - t0;
+		sei();
+		total += t;
+		if (t > *worst) *worst = t;
+	}
+	return total / RUNS;
+}
+
+void report(const char *name, void (*conv)(void))
+{
+	uint16_t avg, worst;
+	avg = time_conv(conv, &worst);
+	printf("%-12s avg %5u worst %5u cycles\n", name, avg, worst);
+}
+
+int main(void)
+{
+	init_stdio2uart0();
+
+	TCCR1A = 0;
+	TCCR1B = _BV(CS10);	/* clk/1 */
+
+	for (;;) {
+		report("%lf volts", float_volts);
+		report("fmt_fixed", fixed_volts);
+		report("%lf gain", float_gain);
+		report("fmt_dec", fixed_gain);
+		report("%d", int_printf);
+		report("fmt_int", int_fmt);
+		printf("\n");
+	}
+}
@@ -1,3 +1,3 @@
 #include <avr/pgmspace.h>
 
-extern const uint8_t font5x7[] PROGMEM;
+extern const uint8_t font5x7_rows[] PROGMEM;
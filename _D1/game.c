@@ -4,45 +4,61 @@
 #include <stdio.h>
 #include <string.h>
 #include "lcd.h"
+#include "drawq.h"
+#include "fmt.h"
+#include "sprite.h"
 
 void writeText(int x, int y, char *str);
 int singlePlayGame();
 int twoPlayGame();
 int endGame();
-void printTime();
+void printTime(int t);
+void render(void);
 
 volatile int timer = 0;//keeps time
 
 volatile int u = 0;//TBD
 
-rectangle squ2 = {50,100, 310, 313};//Global decleration of bat
+sprite bat; //drawn by the main loop, at the position the buttons queued
+sprite ball;
 
 int score; //keeps score
 
+/* The ISRs only queue what changed, the main loop draws it (render) */
+enum {DRAW_BAT, DRAW_TIME};
+drawq draws;
+uint16_t batLeft = 50; //the bat's position as the buttons have set it, ISRs only
+#define BAT_W (100 - 50)
+#define BAT_Y 310
+
+/* Frame pacing: Timer1 CTC at clk/64, 3125 counts is exactly 60 Hz */
+#define FPS 60
+volatile uint8_t frames; //ticks so far, the main loop draws one frame per tick
+
 //moves the bat to the left when button is pressed
 ISR(INT1_vect){
-	fill_rectangle(squ2, BLACK);
-	if(squ2.left >= 6){
-		squ2.left = squ2.left - 5;
-		squ2.right = squ2.right - 5;
+	if(batLeft >= 6){
+		batLeft -= 5;
 	}
-	fill_rectangle(squ2, WHITE);
+	drawq_put(&draws, DRAW_BAT, 0, batLeft, 0);
 }
 
 //moves bat to the right when button is pressed.
 ISR(INT0_vect){
-	fill_rectangle(squ2, BLACK);
-	if(squ2.right <= 235){
-		squ2.left = squ2.left + 5;
-		squ2.right = squ2.right + 5;
+	if(batLeft + BAT_W <= 235){
+		batLeft += 5;
 	}
-	fill_rectangle(squ2, WHITE);
+	drawq_put(&draws, DRAW_BAT, 0, batLeft, 0);
 }
 
 ISR(TIMER1_COMPA_vect){
+	static uint8_t tick;
+	frames++;
+	if(++tick < FPS) return;
+	tick = 0;
 	timer++;
 	score = timer;
-	printTime();
+	drawq_put(&draws, DRAW_TIME, 0, timer, 0);
 }
 
 int main()
@@ -52,28 +68,41 @@ int main()
 
 }
 
-void printTime(){
+/* Drains the queue, keeping only the newest of each kind; the bat
+   sprite then repaints just the strips it left and entered */
+void render(void){
+	drawq_cmd c;
+	int t = -1;
+	
+	while(drawq_get(&draws, &c)){
+		if(c.op == DRAW_BAT){
+			sprite_place(&bat, c.x, BAT_Y);
+		}else if(c.op == DRAW_TIME){
+			t = c.x;
+		}
+	}
+	sprite_draw(&bat);
+	if(t >= 0){
+		printTime(t);
+	}
+}
+
+void printTime(int t){
 	
-	int x = 0;//location of the string x-axis
-	int y = 0;//location of the string y-axis
-	int minutes;	//holds minutes
-	int seconds;	//holds seconds
-	char minutesCH[99]; //holds the ASCII of minutes
-	char secondsCH[99];	//holds the ASCII of seconds
+	char text[FMT_BUF + 8];
+	uint8_t n;
 	
 	//changes where string is placed
-	display.x = x;
-	display.y = y;
+	display.x = 0;
+	display.y = 0;
 	
-	display_string("Time:");
-	minutes = timer/60;	//gets the value of minutes
-	seconds = timer%60;	//gets the value of seconds
-	sprintf(minutesCH, "%d", minutes);//takes out the number of minutes
-	sprintf(secondsCH, "%d", seconds);//takes out the number of seconds
-	display_string(minutesCH);
-	display_string(":");
-	display_string(secondsCH);
-	display_string("   ");
+	strcpy(text, "Time:");
+	n = 5;
+	n += fmt_int(text + n, t/60, 0);	//minutes
+	text[n++] = ':';
+	n += fmt_int(text + n, t%60, 0);	//seconds
+	strcpy(text + n, "   ");
+	display_string(text);
 	
 }
 
@@ -135,21 +164,16 @@ void writeText(int x, int y, char *str){
 
 int singlePlayGame(){
 
-	int i = 0;	//for the incremental movement along horizontal
-	int j = 0;	//for the incremental movement along vertical
-	
 	int xD = 0; // This is the direction of the x value changing, 1 is left and 0 is right
 	int yD = 0; // This is the direction of the y value changing, 1 is down and 0 is up
 	
-	int incrementI = 2;	//increments or decrements the cube in the x-axis
-	int incrementJ = 2;	//increments or decrements the cube in the y-axis
+	int incrementI = 2;	//margin for collisions in the x-axis, about a frame's movement
+	int incrementJ = 2;	//margin for collisions in the y-axis
+	int16_t speed = SPRITE_PX(100.0/FPS);	//100 pixels a second along each axis, as at 2 pixels per 20 ms
+	uint8_t drawn;	//frame count last drawn
 	
-	int square_l = 157; //this is the left value of rectangle
-    int square_r = 162; //this is the right value of rectangle
-	int square_t = 137; //this is the top value of rectangle
-	int square_b = 142; //this is the bottom value of rectangle
-	int cubeHi = square_b - square_t;	//determines rectangles width
-	int cubeWi = square_r - square_l;	//determines rectangles length
+	int cubeHi = 142 - 137;	//determines rectangles width
+	int cubeWi = 162 - 157;	//determines rectangles length
 	
 	int rect2L = 0; //this is the left value of rectangle
 	int rect2R = 240;//this is the right value of rectangle
@@ -161,22 +185,24 @@ int singlePlayGame(){
 	clear_screen();//clears screen
 	
 	set_orientation(North);//sets orientation to north
+	lcd_tear_sync(1);//sprites are drawn behind the panel's scan line
+	
+	sprite_init(&ball, 157, 137, cubeWi + 1, cubeHi + 1, PURPLE); //this is the pong ball
+	sprite_init(&bat, batLeft, BAT_Y, BAT_W + 1, 4, WHITE); //this is the bat
 	
-	rectangle squ = {square_l,square_r,square_t,square_b}; //this is the ball
-		
 	rectangle squ3 = {rect2L,rect2R,rect2T,rect2B};//this is a second bat
 	
-	fill_rectangle(squ, PURPLE);//displays the pong ball on screen in purple
-	fill_rectangle(squ2, WHITE);//displays the bat
+	sprite_draw(&ball);//displays the pong ball on screen in purple
+	sprite_draw(&bat);//displays the bat
 	fill_rectangle(squ3, WHITE);
 	
-	//Initialize the counter IN FAST PWM mode
+	//Initialize the counter in CTC mode, clk/64
 	TCCR1A = 0;
 	TCCR1B = _BV(WGM12);
-	TCCR1B |= _BV(CS12)|_BV(CS10);
+	TCCR1B |= _BV(CS11)|_BV(CS10);
 	
-	//sets the top of the counter to be a certain value so that when it reaches the top 1 second has passed, uses the 1024 prescaler	
-	OCR1A = 11718;
+	//one compare match per frame, FPS of them make the second the clock counts
+	OCR1A = F_CPU/64/FPS - 1;
 	
 	//sets the external interrupt to be detected on falling edge
 	EICRA |= _BV(ISC01);
@@ -187,15 +213,19 @@ int singlePlayGame(){
 	EIMSK |= _BV(INT1);
 	//timer interrupt
 	TIMSK1 |= _BV(OCIE1A) ; 
+	drawq_init(&draws);
 	sei();
 	
-	
+	drawn = frames;
 	
 	for(;;){
 		
-		_delay_ms(20);
-		//fake animation
-		fill_rectangle(squ, BLACK);
+		while(frames == drawn); //waits for the next frame tick
+		drawn = frames;
+		render(); //the bat and clock, as the ISRs queued them
+		
+		rectangle squ = sprite_rect(&ball);
+		rectangle squ2 = bat.shown;
 		
 		//collision detection between the square and bat via the x-axis
 		if((squ.right>=(squ2.left-(incrementI)))&&(squ.left<=(squ2.right+incrementI))&&(squ.top>=(squ2.top-cubeHi))&&(squ.bottom<=(squ2.bottom+cubeHi))){
@@ -207,11 +237,6 @@ int singlePlayGame(){
 			yD = !yD;
 		}
 		
-		/* if((squ.right>=(squ2.left-(incrementI)))&&(squ.left<=(squ2.right+incrementI))&&(squ.top>=(squ2.top-cubeHi))&&(squ.bottom<=(squ2.bottom+cubeHi))&&(squ.right>=(squ2.left-(incrementI)))&&(squ.left<=(squ2.right+incrementI))&&(squ.top>=(squ2.top-cubeHi))&&(squ.bottom<=(squ2.bottom+cubeHi))){
-			yD = !yD;
-			xD = !xD;
-		} */
-		
 		//This will check if the cube is at the border
 		if((display.width-incrementI) <= (squ.right)){xD = 1;}
 		if(incrementI >= (squ.left)){xD = 0;}
@@ -223,28 +248,13 @@ int singlePlayGame(){
 		}
 		if((incrementJ+10) >= (squ.top)){yD = 0;}
 		
-		//increments or decrements the balls position based on the direction x-axis
-		if(xD){
-			i = i-incrementI;
-		}else{
-			i = i+incrementI;
-		}
-		
-		//increments or decrements the balls position based on the direction y-axis
-		if(yD){
-			j = j-incrementJ;
-		}else{
-			j = j+incrementJ;
-		}
-		
-		//updates the position of the pong ball
-		squ.right = square_r + i;
-		squ.left = square_l + i;
-		squ.bottom = square_b + j;
-		squ.top = square_t + j;
+		//sets the balls velocity from the directions, in sub-pixels per frame
+		ball.vx = xD ? -speed : speed;
+		ball.vy = yD ? -speed : speed;
 		
-		//displays the new ball
-		fill_rectangle(squ, PURPLE);
+		//moves the pong ball, repainting only the strips that changed
+		sprite_step(&ball);
+		sprite_draw(&ball);
 	}
 	
 }
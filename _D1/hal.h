@@ -0,0 +1,132 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include "adc.h"
+
+/* Thin hardware layer for the boost controller.
+ *
+ * hal_avr.c drives the ATmega644p registers, hal_host.c builds the same
+ * firmware as a Linux executable (make host) with simulated time. ADC
+ * access is the adc.h interface, which both backends provide.
+ */
+
+/* Timer1 runs at clk/HAL_TICK_DIV in CTC mode; compare value for a tick */
+#define HAL_TICK_DIV		8
+#define HAL_TICK_CLOCK		(F_CPU/HAL_TICK_DIV)
+#define HAL_TICK_TOP(hz)	((uint16_t)(HAL_TICK_CLOCK/(hz) - 1))
+
+typedef enum {HAL_PORTA, HAL_PORTB, HAL_PORTC, HAL_PORTD} hal_port;
+
+/* UART0, 8N1; stdio is redirected to it by hal_stdio_init().
+ *
+ * hal_uart_init() picks normal or double speed (U2X) mode, whichever is
+ * closer to the requested rate; from 12 MHz, 250000 and 500000 baud are
+ * exact. Transmit goes through a ring drained by USART0_UDRE_vect, so
+ * hal_uart_putc() costs a few cycles unless the ring is full, in which
+ * case the policy decides:
+ *   HAL_TX_BLOCK     wait for space (the default); with interrupts
+ *                    disabled, e.g. inside an ISR, this drops instead
+ *   HAL_TX_DROP      discard the new byte
+ *   HAL_TX_OVERWRITE discard the oldest queued byte
+ * Discarded bytes are counted by hal_uart_tx_dropped(), and
+ * hal_uart_tx_free() lets a producer queue a whole packet or none of it.
+ */
+#ifndef HAL_UART_TX_SIZE
+#define HAL_UART_TX_SIZE	128	/* power of two, at most 256 */
+#endif
+
+typedef enum {HAL_TX_BLOCK, HAL_TX_DROP, HAL_TX_OVERWRITE} hal_tx_policy;
+
+void hal_uart_init(uint32_t baud);
+void hal_uart_putc(uint8_t c);
+uint8_t hal_uart_getc(void);
+void hal_uart_rx_int(uint8_t on);
+void hal_uart_tx_policy(hal_tx_policy p);
+uint16_t hal_uart_tx_dropped(void);
+uint8_t hal_uart_tx_free(void);
+void hal_uart_flush(void);
+void hal_stdio_init(void);
+
+/* Timer2 fast PWM on OC2A, duty as a raw OCR2A value.
+ *
+ * hal_pwm_write16() takes the duty as 8.8 fixed point OCR2A counts. With
+ * hal_pwm_dither(1), TIMER2_OVF_vect adds the fraction to an accumulator
+ * every carrier period and sets OCR2A one count higher on each carry: a
+ * first order sigma-delta, so the mean duty resolves 1/65536 of a period
+ * (12 bits over any 16 periods) with the carrier still at F_CPU/256. It
+ * costs one interrupt per period: response, vector jump, a prologue and
+ * epilogue saving SREG and three registers, three lds, the add and carry
+ * and two sts come to about 50 cycles of every 256, some 20% of the CPU.
+ * With CTRL_SYNC in boost.c, ADC_vect runs at the carrier rate too and
+ * calls out of the ISR, saving every call-clobbered register, so the two
+ * take roughly half of it. Without dithering the value is rounded
+ * to whole counts.
+ *
+ * A 16-bit timer would not add resolution: at a F_CPU/256 carrier any
+ * timer has 256 counts a period, and Timer1 is the tick.
+ */
+void hal_pwm_init(void);
+void hal_pwm_write(uint8_t x);
+void hal_pwm_write16(uint16_t x);
+void hal_pwm_dither(uint8_t on);
+
+/* Timer1 runs TIMER1_COMPA_vect every (top+1)*HAL_TICK_DIV cycles.
+ * hal_tick_phase() is the Timer1 count since the last tick, plus a period
+ * if that tick's interrupt is still pending; call it with interrupts off.
+ */
+void hal_tick_init(uint16_t top);
+uint16_t hal_tick_phase(void);
+
+/* Overvoltage trip. When Vout crosses the trip point an ISR disconnects
+ * OC2A from Timer2, so the pin drops to its PORTD latch, 0, and the PWM
+ * stays off until hal_ovp_arm(), whatever the rest of the firmware is
+ * doing. hal_ovp_trip() does the same from software.
+ *
+ * The trip point is limit, in raw 10-bit ADC counts: ADC_vect checks
+ * every conversion (adc_limit()), which reacts within one conversion,
+ * 70 us free running or 17 us in the synchronous mode. Built with
+ * HAL_OVP_COMP=1 the analog comparator trips instead, bandgap on AIN0
+ * against a Vout divider on AIN1 (PB3), and ANA_COMP_vect cuts the PWM
+ * about a microsecond after the edge; limit is then set by the divider.
+ * On La Fortuna PB2 and PB3 carry LCD data, so it is off by default.
+ *
+ * hal_ovp_arm() reconnects the PWM unless Vout is still over, and returns
+ * whether it did.
+ */
+#ifndef HAL_OVP_COMP
+#define HAL_OVP_COMP		0
+#endif
+
+void hal_ovp_init(uint16_t limit);
+void hal_ovp_trip(void);
+uint8_t hal_ovp_tripped(void);
+uint8_t hal_ovp_arm(void);
+
+/* EEPROM, HAL_EEPROM_SIZE bytes. hal_eeprom_write() starts the erase and
+ * write of one byte, 3.4 ms on the AVR, and returns at once; don't start
+ * another or read until hal_eeprom_busy() is clear.
+ */
+#define HAL_EEPROM_SIZE		2048
+
+uint8_t hal_eeprom_read(uint16_t addr);
+void hal_eeprom_write(uint16_t addr, uint8_t x);
+uint8_t hal_eeprom_busy(void);
+
+/* INT0/INT1 buttons, falling edge */
+void hal_ext_int_init(void);
+
+void hal_gpio_output(hal_port p, uint8_t pin);
+void hal_gpio_write(hal_port p, uint8_t pin, uint8_t on);
+uint8_t hal_gpio_read(hal_port p, uint8_t pin);
+
+/* Called once per pass of the main loop. The host backend advances the
+ * simulated clock to the next tick and runs any pending interrupts.
+ */
+#ifdef HOST
+void hal_idle(void);
+#else
+#define hal_idle()
+#endif
+
+#endif
@@ -0,0 +1,359 @@
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+#include "hal.h"
+
+#define TX_MASK	(HAL_UART_TX_SIZE - 1)
+
+#if HAL_UART_TX_SIZE > 256 || (HAL_UART_TX_SIZE & TX_MASK)
+#error HAL_UART_TX_SIZE must be a power of two, at most 256
+#endif
+
+static volatile uint8_t *const port_reg[] = {&PORTA, &PORTB, &PORTC, &PORTD};
+static volatile uint8_t *const ddr_reg[] = {&DDRA, &DDRB, &DDRC, &DDRD};
+static volatile uint8_t *const pin_reg[] = {&PINA, &PINB, &PINC, &PIND};
+
+static uint8_t tx_buf[HAL_UART_TX_SIZE];
+static volatile uint8_t tx_head, tx_tail;	/* head: producers, tail: UDRE */
+static volatile uint16_t tx_dropped;
+static uint8_t tx_policy = HAL_TX_BLOCK;
+
+/* Distance of the nearest UBRR setting from baud, in Hz of baud rate */
+static uint32_t baud_error(uint32_t baud, uint8_t div, uint16_t *ubrr)
+{
+	uint32_t r = (F_CPU + baud*div/2)/(baud*div);
+	uint32_t actual;
+
+	if (r == 0) r = 1;
+	if (r > 4096) r = 4096;
+	*ubrr = r - 1;
+	actual = F_CPU/(div*r);
+	return actual > baud ? actual - baud : baud - actual;
+}
+
+void hal_uart_init(uint32_t baud)
+{
+	uint16_t ubrr, ubrr2x;
+
+	/* Double speed only when it is strictly closer, the receiver samples
+	   fewer times per bit in U2X mode */
+	if (baud_error(baud, 8, &ubrr2x) < baud_error(baud, 16, &ubrr)) {
+		UCSR0A = _BV(U2X0);
+		ubrr = ubrr2x;
+	} else {
+		UCSR0A = 0;
+	}
+	/* Configure UART0 baud rate, one start bit, 8-bit, no parity and one stop bit */
+	UBRR0H = ubrr >> 8;
+	UBRR0L = ubrr;
+	UCSR0B = _BV(RXEN0) | _BV(TXEN0);
+	UCSR0C = _BV(UCSZ00) | _BV(UCSZ01);
+	tx_head = tx_tail = 0;
+}
+
+ISR(USART0_UDRE_vect)
+{
+	uint8_t t = tx_tail;
+
+	if (t == tx_head) {
+		UCSR0B &= ~_BV(UDRIE0);		/* ring empty, stop until the next putc */
+		return;
+	}
+	UDR0 = tx_buf[t];
+	tx_tail = (t + 1) & TX_MASK;
+}
+
+void hal_uart_putc(uint8_t c)
+{
+	uint8_t next, sreg = SREG;
+
+	cli();
+	if (tx_head == tx_tail && (UCSR0A & _BV(UDRE0))) {
+		UDR0 = c;			/* idle transmitter, skip the ring */
+		SREG = sreg;
+		return;
+	}
+	next = (tx_head + 1) & TX_MASK;
+	while (next == tx_tail) {
+		if (tx_policy == HAL_TX_BLOCK && (sreg & _BV(SREG_I))) {
+			/* let USART0_UDRE_vect make room: the instruction after
+			 * I is set always runs first, so without the nop cli()
+			 * would close the window and the ring never drain
+			 */
+			SREG = sreg;
+			asm volatile ("nop");
+			cli();
+			continue;
+		}
+		tx_dropped++;
+		if (tx_policy != HAL_TX_OVERWRITE) {
+			SREG = sreg;
+			return;
+		}
+		tx_tail = (tx_tail + 1) & TX_MASK;
+	}
+	tx_buf[tx_head] = c;
+	tx_head = next;
+	UCSR0B |= _BV(UDRIE0);
+	SREG = sreg;
+}
+
+void hal_uart_tx_policy(hal_tx_policy p)
+{
+	tx_policy = p;
+}
+
+uint16_t hal_uart_tx_dropped(void)
+{
+	uint16_t d;
+	uint8_t sreg = SREG;
+	cli();
+	d = tx_dropped;
+	SREG = sreg;
+	return d;
+}
+
+uint8_t hal_uart_tx_free(void)
+{
+	return (tx_tail - tx_head - 1) & TX_MASK;
+}
+
+/* Wait until the ring is empty; the last byte may still be shifting out */
+void hal_uart_flush(void)
+{
+	while (tx_head != tx_tail) {
+		if (!(SREG & _BV(SREG_I)) && (UCSR0A & _BV(UDRE0))) {
+			UDR0 = tx_buf[tx_tail];		/* drain by polling with interrupts off */
+			tx_tail = (tx_tail + 1) & TX_MASK;
+		}
+	}
+}
+
+uint8_t hal_uart_getc(void)
+{
+	while(!(UCSR0A & _BV(RXC0)));
+	return UDR0;
+}
+
+void hal_uart_rx_int(uint8_t on)
+{
+	if (on)
+		UCSR0B |= _BV(RXCIE0);
+	else
+		UCSR0B &= ~_BV(RXCIE0);
+}
+
+static int uputchar0(char c, FILE *stream)
+{
+	if (c == '\n') uputchar0('\r', stream);
+	hal_uart_putc(c);
+	return c;
+}
+
+static int ugetchar0(FILE *stream)
+{
+	return hal_uart_getc();
+}
+
+void hal_stdio_init(void)
+{
+	/* Setup new streams for input and output */
+	static FILE uout = FDEV_SETUP_STREAM(uputchar0, NULL, _FDEV_SETUP_WRITE);
+	static FILE uin = FDEV_SETUP_STREAM(NULL, ugetchar0, _FDEV_SETUP_READ);
+
+	/* Redirect all standard streams to UART0 */
+	stdout = &uout;
+	stderr = &uout;
+	stdin = &uin;
+}
+
+void hal_pwm_init(void)
+{
+	/* TIMER 2 */
+	DDRD |= _BV(PD6); /* PWM out */
+	DDRD |= _BV(PD7); /* inv. PWM out */
+
+	TCCR2A = _BV(WGM20) | /* fast PWM/MAX */
+		 _BV(WGM21) | /* fast PWM/MAX */
+		 _BV(COM2A1); /* A output */
+	TCCR2B = _BV(CS20);   /* no prescaling */
+}
+
+static volatile uint16_t pwm_x;	/* 8.8 duty for TIMER2_OVF_vect */
+static volatile uint8_t pwm_acc;
+
+void hal_pwm_write(uint8_t x)
+{
+	hal_pwm_write16((uint16_t)x << 8);
+}
+
+void hal_pwm_write16(uint16_t x)
+{
+	uint8_t sreg = SREG;
+	if (x > 0xFE00) x = 0xFE00;	/* a carry must not wrap OCR2A */
+	if (!(TIMSK2 & _BV(TOIE2))) {
+		OCR2A = (x + 0x80) >> 8;
+		return;
+	}
+	cli();
+	pwm_x = x;
+	SREG = sreg;
+}
+
+/* OCR2A is buffered to BOTTOM, so this sets the period after next */
+ISR(TIMER2_OVF_vect)
+{
+	uint16_t x = pwm_x;	/* volatile, read once */
+	uint8_t f = x, a = pwm_acc + f;
+	OCR2A = (x >> 8) + (a < f);
+	pwm_acc = a;
+}
+
+void hal_pwm_dither(uint8_t on)
+{
+	if (on) {
+		pwm_x = (uint16_t)OCR2A << 8;
+		TIMSK2 |= _BV(TOIE2);
+	} else {
+		TIMSK2 &= ~_BV(TOIE2);
+		OCR2A = (pwm_x + 0x80) >> 8;
+	}
+}
+
+void hal_tick_init(uint16_t top)
+{
+	TCCR1A = 0;
+	TCCR1B = _BV(WGM12);		/* CTC, TOP = OCR1A */
+	TCCR1B |= _BV(CS11);		/* clk/8, HAL_TICK_DIV */
+	OCR1A = top;
+	TIMSK1 |= _BV(OCIE1A);
+}
+
+uint16_t hal_tick_phase(void)
+{
+	uint16_t p = TCNT1;
+	/* TCNT1 is read again, it may have wrapped just before the flag test */
+	if (TIFR1 & _BV(OCF1A))
+		p = TCNT1 + OCR1A + 1;
+	return p;
+}
+
+static uint16_t ovp_limit;
+static volatile uint8_t ovp_tripped;
+
+/* Only register writes, so the prologue is short */
+static void ovp_cut(void)
+{
+	TCCR2A &= ~_BV(COM2A1);
+	ovp_tripped = 1;
+}
+
+#if HAL_OVP_COMP
+ISR(ANA_COMP_vect)
+{
+	TCCR2A &= ~_BV(COM2A1);
+	ACSR &= ~_BV(ACIE);	/* no storm while Vout hovers at the trip point */
+	ovp_tripped = 1;
+}
+#endif
+
+void hal_ovp_init(uint16_t limit)
+{
+	PORTD &= ~_BV(PD7);	/* OC2A level while disconnected */
+	ovp_limit = limit;
+#if HAL_OVP_COMP
+	DIDR1 = _BV(AIN1D);
+	/* ACO is high while the bandgap is above AIN1, trip on its fall */
+	ACSR = _BV(ACBG) | _BV(ACI) | _BV(ACIS1);
+	_delay_us(70);	/* bandgap start up */
+	ACSR = _BV(ACBG) | _BV(ACI) | _BV(ACIS1) | _BV(ACIE);
+#else
+	adc_limit(limit, ovp_cut);
+#endif
+}
+
+void hal_ovp_trip(void)
+{
+	uint8_t sreg = SREG;
+	cli();
+	ovp_cut();
+	SREG = sreg;
+}
+
+uint8_t hal_ovp_tripped(void)
+{
+	return ovp_tripped;
+}
+
+uint8_t hal_ovp_arm(void)
+{
+	uint8_t sreg = SREG, ok;
+	cli();
+#if HAL_OVP_COMP
+	ACSR = (ACSR & ~_BV(ACIE)) | _BV(ACI);
+	ok = (ACSR & _BV(ACO)) != 0;
+	if (ok)	/* ACI written 0, so an edge since the test still trips */
+		ACSR = (ACSR & ~_BV(ACI)) | _BV(ACIE);
+#else
+	ok = ADC <= ovp_limit;
+#endif
+	if (ok) {
+		ovp_tripped = 0;
+		TCCR2A |= _BV(COM2A1);
+	}
+	SREG = sreg;
+	return ok;
+}
+
+uint8_t hal_eeprom_read(uint16_t addr)
+{
+	while (EECR & _BV(EEPE));
+	EEAR = addr;
+	EECR |= _BV(EERE);
+	return EEDR;
+}
+
+void hal_eeprom_write(uint16_t addr, uint8_t x)
+{
+	uint8_t sreg = SREG;
+	while (EECR & _BV(EEPE));
+	EEAR = addr;
+	EEDR = x;
+	cli();	/* EEPE within 4 cycles of EEMPE */
+	EECR = _BV(EEMPE);	/* EEPM = 0: erase and write */
+	EECR |= _BV(EEPE);
+	SREG = sreg;
+}
+
+uint8_t hal_eeprom_busy(void)
+{
+	return (EECR & _BV(EEPE)) != 0;
+}
+
+void hal_ext_int_init(void)
+{
+	/* Trigger INT0 and INT1 on the falling edge */
+	EICRA |= _BV(ISC01);
+	EICRA |= _BV(ISC11);
+	EIMSK |= _BV(INT0);
+	EIMSK |= _BV(INT1);
+}
+
+void hal_gpio_output(hal_port p, uint8_t pin)
+{
+	*ddr_reg[p] |= _BV(pin);
+}
+
+void hal_gpio_write(hal_port p, uint8_t pin, uint8_t on)
+{
+	if (on)
+		*port_reg[p] |= _BV(pin);
+	else
+		*port_reg[p] &= ~_BV(pin);
+}
+
+uint8_t hal_gpio_read(hal_port p, uint8_t pin)
+{
+	return (*pin_reg[p] >> pin) & 1;
+}
@@ -0,0 +1,412 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "hal.h"
+#include "hal_host.h"
+#include "lcd_host.h"
+#include "plant.h"
+
+#define F_TIMER1	HAL_TICK_CLOCK
+
+volatile uint8_t PORTA, PORTB, PORTC, PORTD;
+volatile uint8_t DDRA, DDRB, DDRC, DDRD;
+volatile uint8_t PINA, PINB, PINC, PIND;
+volatile uint8_t MCUCR;
+volatile uint8_t hal_host_sreg_i;
+
+static volatile uint8_t *const port_reg[] = {&PORTA, &PORTB, &PORTC, &PORTD};
+static volatile uint8_t *const ddr_reg[] = {&DDRA, &DDRB, &DDRC, &DDRD};
+static volatile uint8_t *const pin_reg[] = {&PINA, &PINB, &PINC, &PIND};
+
+/* Vectors the firmware may define */
+void TIMER1_COMPA_vect(void) __attribute__((weak));
+void USART0_RX_vect(void) __attribute__((weak));
+
+uint64_t hal_host_ns;
+uint8_t hal_host_pwm;
+uint16_t hal_host_pwm16;
+uint16_t hal_host_adc;
+uint32_t hal_host_ticks;
+void (*hal_host_step)(uint32_t dt_ns);
+plant hal_host_plant;
+
+static uint64_t tick_ns, next_tick_ns, loop_ns;
+static uint64_t sync_ns, next_sync_ns;	/* adc_init_sync() steps */
+static void (*sync_step)(uint16_t);
+static uint32_t tick_limit;
+static uint8_t trace;
+static struct timespec wall_start;
+
+static uint16_t ovp_limit;
+static uint8_t ovp_on, ovp_tripped;	/* checked after every plant step */
+
+#define EEPROM_WRITE_NS	3400000u
+static uint8_t eeprom[HAL_EEPROM_SIZE];
+static uint64_t eeprom_done_ns;
+static FILE *eeprom_file;	/* HAL_EEPROM, written through */
+
+static uint8_t rx_buf[64];
+static uint8_t rx_head, rx_tail, rx_eof, rx_int;
+
+static void report(void)
+{
+	struct timespec now;
+	double wall, sim = hal_host_ns*1e-9;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	wall = (now.tv_sec - wall_start.tv_sec) + (now.tv_nsec - wall_start.tv_nsec)*1e-9;
+	fprintf(stderr, "hal_host: %u ticks, %.3f s simulated in %.3f s (%.0fx real time)\n",
+		hal_host_ticks, sim, wall, wall > 0 ? sim/wall : 0.0);
+}
+
+static void plant_step(uint32_t dt_ns)
+{
+	plant_run(&hal_host_plant, ovp_tripped ? 0.0 : plant_duty16(hal_host_pwm16), dt_ns*1e-9);
+	hal_host_adc = plant_adc(&hal_host_plant, ADC_OSR_BITS);
+	if (ovp_on && hal_host_adc >> ADC_OSR_BITS > ovp_limit)
+		ovp_tripped = 1;
+}
+
+static void plant_env(const char *name, double *v)
+{
+	const char *s = getenv(name);
+	if (s) *v = strtod(s, NULL);
+}
+
+__attribute__((constructor))
+static void host_init(void)
+{
+	const char *s;
+	if ((s = getenv("HAL_TICKS"))) tick_limit = strtoul(s, NULL, 0);
+
+	plant_init(&hal_host_plant);
+	plant_env("PLANT_VIN", &hal_host_plant.vin);
+	plant_env("PLANT_R", &hal_host_plant.r);
+	plant_env("PLANT_L", &hal_host_plant.l);
+	plant_env("PLANT_C", &hal_host_plant.c);
+	plant_env("PLANT_ESR", &hal_host_plant.esr);
+	if ((s = getenv("PLANT_FAST")) && atoi(s) > 0) {
+		hal_host_plant.exact = 1;
+		hal_host_plant.h = atoi(s)/hal_host_plant.fsw;
+	}
+	plant_env("PLANT_H", &hal_host_plant.h);
+	if ((s = getenv("HAL_ADC")))
+		hal_host_adc = strtoul(s, NULL, 0);
+	else
+		hal_host_step = plant_step;
+	if ((s = getenv("HAL_LOOP_US"))) loop_ns = strtoull(s, NULL, 0)*1000u;
+	trace = getenv("HAL_TRACE") != NULL;
+	memset(eeprom, 0xFF, sizeof(eeprom));	/* erased */
+	if ((s = getenv("HAL_EEPROM"))) {
+		if ((eeprom_file = fopen(s, "r+b")))
+			fread(eeprom, 1, sizeof(eeprom), eeprom_file);
+		else if ((eeprom_file = fopen(s, "w+b")))
+			fwrite(eeprom, 1, sizeof(eeprom), eeprom_file);
+		if (eeprom_file) fflush(eeprom_file);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &wall_start);
+}
+
+static void advance(uint64_t dt)
+{
+	/* Plants integrate in steps that fit 32 bits */
+	while (dt) {
+		uint32_t step = dt > 1000000000u ? 1000000000u : dt;
+		hal_host_ns += step;
+		if (hal_host_step) hal_host_step(step);
+		dt -= step;
+	}
+}
+
+void hal_host_delay_us(double us)
+{
+	advance((uint64_t)(us*1000.0));
+}
+
+static void poll_rx(void)
+{
+	struct pollfd p = {0, POLLIN, 0};
+	uint8_t next = (rx_head + 1) % sizeof(rx_buf);
+	while (!rx_eof && next != rx_tail && poll(&p, 1, 0) > 0) {
+		if (read(0, &rx_buf[rx_head], 1) != 1) {
+			rx_eof = 1;
+			break;
+		}
+		rx_head = next;
+		next = (rx_head + 1) % sizeof(rx_buf);
+	}
+}
+
+static void tick(void)
+{
+	TIMER1_COMPA_vect();
+	hal_host_ticks++;
+	if (trace)
+		fprintf(stderr, "%.6f,%u,%u,%.4f,%.4f\n", hal_host_ns*1e-9, hal_host_adc,
+			hal_host_pwm, hal_host_plant.vout, hal_host_plant.il);
+	if (tick_limit && hal_host_ticks >= tick_limit) {
+		fflush(stdout);
+		report();
+		exit(0);
+	}
+}
+
+void hal_idle(void)
+{
+	uint64_t end;
+
+	if (!hal_host_sreg_i)
+		return;
+
+	lcd_host_frame();	/* a main loop pass is a display frame */
+	poll_rx();
+	while (rx_int && rx_head != rx_tail && USART0_RX_vect)
+		USART0_RX_vect();
+
+	if (!tick_ns || !TIMER1_COMPA_vect)
+		return;
+	/* A tick missed during a delay fires once, as the compare flag would */
+	if (next_tick_ns <= hal_host_ns) {
+		next_tick_ns = hal_host_ns + tick_ns;
+		tick();
+	}
+	if (sync_step && next_sync_ns <= hal_host_ns)
+		next_sync_ns = hal_host_ns + sync_ns;
+	end = hal_host_ns + (loop_ns ? loop_ns : tick_ns);
+	for (;;) {
+		uint64_t next = next_tick_ns;
+		if (sync_step && next_sync_ns < next)
+			next = next_sync_ns;
+		if (next > end)
+			break;
+		advance(next - hal_host_ns);
+		if (sync_step && next_sync_ns == next) {
+			next_sync_ns += sync_ns;
+			sync_step(hal_host_adc);
+		}
+		if (next_tick_ns == next) {
+			next_tick_ns += tick_ns;
+			tick();
+		}
+	}
+	advance(end - hal_host_ns);
+}
+
+void hal_uart_init(uint32_t baud)
+{
+}
+
+void hal_uart_putc(uint8_t c)
+{
+	putchar(c);
+}
+
+/* stdout never fills, so the policy has nothing to decide */
+void hal_uart_tx_policy(hal_tx_policy p)
+{
+}
+
+uint16_t hal_uart_tx_dropped(void)
+{
+	return 0;
+}
+
+uint8_t hal_uart_tx_free(void)
+{
+	return HAL_UART_TX_SIZE - 1;
+}
+
+void hal_uart_flush(void)
+{
+	fflush(stdout);
+}
+
+uint8_t hal_uart_getc(void)
+{
+	uint8_t c;
+	if (rx_head == rx_tail) {
+		/* Blocking, like waiting on RXC0 */
+		if (read(0, &c, 1) != 1) {
+			rx_eof = 1;
+			fflush(stdout);
+			report();
+			exit(0);
+		}
+		return c;
+	}
+	c = rx_buf[rx_tail];
+	rx_tail = (rx_tail + 1) % sizeof(rx_buf);
+	return c;
+}
+
+void hal_uart_rx_int(uint8_t on)
+{
+	rx_int = on;
+}
+
+static ssize_t uart_read(void *cookie, char *buf, size_t size)
+{
+	if (size == 0) return 0;
+	buf[0] = hal_uart_getc();
+	return 1;
+}
+
+void hal_stdio_init(void)
+{
+	/* stdin reads through the RX buffer so USART0_RX_vect sees the bytes */
+	static cookie_io_functions_t io = {uart_read, NULL, NULL, NULL};
+	stdin = fopencookie(NULL, "r", io);
+	setvbuf(stdin, NULL, _IONBF, 0);
+}
+
+void hal_pwm_init(void)
+{
+	DDRD |= _BV(PD6) | _BV(PD7);
+}
+
+static uint8_t dither;
+
+void hal_pwm_write(uint8_t x)
+{
+	hal_pwm_write16((uint16_t)x << 8);
+}
+
+/* The plant sees the mean duty; dithering only changes its resolution */
+void hal_pwm_write16(uint16_t x)
+{
+	if (x > 0xFE00) x = 0xFE00;
+	if (!dither) x = (x + 0x80) & 0xFF00;
+	hal_host_pwm16 = x;
+	hal_host_pwm = x >> 8;
+}
+
+void hal_pwm_dither(uint8_t on)
+{
+	dither = on;
+}
+
+void hal_tick_init(uint16_t top)
+{
+	tick_ns = (uint64_t)(top + 1)*1000000000u/F_TIMER1;
+	next_tick_ns = hal_host_ns + tick_ns;
+}
+
+/* Simulated time only moves in hal_idle(), so code between two calls
+ * takes no time here
+ */
+uint16_t hal_tick_phase(void)
+{
+	return (hal_host_ns - (next_tick_ns - tick_ns))*F_TIMER1/1000000000u;
+}
+
+void hal_ovp_init(uint16_t limit)
+{
+	ovp_limit = limit;
+	ovp_on = 1;
+}
+
+void hal_ovp_trip(void)
+{
+	ovp_tripped = 1;
+}
+
+uint8_t hal_ovp_tripped(void)
+{
+	return ovp_tripped;
+}
+
+uint8_t hal_ovp_arm(void)
+{
+	if (hal_host_adc >> ADC_OSR_BITS > ovp_limit)
+		return 0;
+	ovp_tripped = 0;
+	return 1;
+}
+
+uint8_t hal_eeprom_read(uint16_t addr)
+{
+	return eeprom[addr % HAL_EEPROM_SIZE];
+}
+
+void hal_eeprom_write(uint16_t addr, uint8_t x)
+{
+	addr %= HAL_EEPROM_SIZE;
+	eeprom[addr] = x;
+	eeprom_done_ns = hal_host_ns + EEPROM_WRITE_NS;
+	if (eeprom_file) {
+		fseek(eeprom_file, addr, SEEK_SET);
+		fputc(x, eeprom_file);
+		fflush(eeprom_file);
+	}
+}
+
+uint8_t hal_eeprom_busy(void)
+{
+	return hal_host_ns < eeprom_done_ns;
+}
+
+void hal_ext_int_init(void)
+{
+}
+
+void hal_gpio_output(hal_port p, uint8_t pin)
+{
+	*ddr_reg[p] |= _BV(pin);
+}
+
+void hal_gpio_write(hal_port p, uint8_t pin, uint8_t on)
+{
+	if (on)
+		*port_reg[p] |= _BV(pin);
+	else
+		*port_reg[p] &= ~_BV(pin);
+	*pin_reg[p] = *port_reg[p];
+}
+
+uint8_t hal_gpio_read(hal_port p, uint8_t pin)
+{
+	return (*pin_reg[p] >> pin) & 1;
+}
+
+/* adc.h, fed by the plant model through hal_host_adc */
+void adc_init(uint8_t channel)
+{
+}
+
+uint16_t adc_latest(void)
+{
+	return hal_host_adc;
+}
+
+uint16_t adc_filtered(void)
+{
+	return hal_host_adc;
+}
+
+uint16_t adc_history(uint8_t age)
+{
+	return hal_host_adc;
+}
+
+uint16_t adc_count(void)
+{
+	return hal_host_ticks;
+}
+
+/* step() runs every div carrier periods of 256 cycles, between ticks */
+void adc_init_sync(uint8_t channel, uint8_t phase, uint8_t div, void (*step)(uint16_t))
+{
+	sync_ns = (uint64_t)(div ? div : 1)*256*1000000000u/F_CPU;
+	next_sync_ns = hal_host_ns + sync_ns;
+	sync_step = step;
+}
+
+uint16_t adc_sync_overruns(void)
+{
+	return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef HAL_HOST_H
+#define HAL_HOST_H
+
+#include <stdint.h>
+#include "plant.h"
+
+/* Simulation side of the host backend.
+ *
+ * Time is simulated in nanoseconds and only advances in hal_idle() and
+ * _delay_ms(), so a run is deterministic and as fast as the CPU allows.
+ * The plant model in plant.c hooks hal_host_step to integrate over each
+ * advance, reads hal_host_pwm and writes hal_host_adc.
+ *
+ * Environment, read at start up:
+ *   HAL_TICKS  stop after this many control ticks (default: run forever)
+ *   HAL_ADC    fixed ADC reading instead of the plant, ADC_BITS wide
+ *   HAL_LOOP_US simulated time per main loop pass (default: one tick),
+ *              large values amortise the LCD redraw over many ticks
+ *   HAL_TRACE  print "time,adc,pwm,vout,il" to stderr after every tick
+ *   HAL_EEPROM file holding the EEPROM between runs, created erased;
+ *              each byte write is stored at once and busy for 3.4 ms
+ *   PLANT_VIN, PLANT_R, PLANT_L, PLANT_C, PLANT_ESR, PLANT_H
+ *              override the plant_init() defaults
+ *   PLANT_FAST n: plant steps of n PWM periods, with CCM solved exactly
+ *              (plant.h). Up to 16 stays within about 0.1 V of the
+ *              default and runs 5-10x faster; above that light loads
+ *              settle at a different duty
+ */
+
+extern uint64_t hal_host_ns;		/* simulated time */
+extern uint8_t hal_host_pwm;		/* OCR2A after the last hal_pwm_write*() */
+extern uint16_t hal_host_pwm16;		/* mean duty as 8.8 OCR2A, see plant_duty16() */
+extern uint16_t hal_host_adc;		/* returned by adc_latest()/adc_filtered() */
+extern uint32_t hal_host_ticks;		/* TIMER1_COMPA_vect calls so far */
+extern void (*hal_host_step)(uint32_t dt_ns);
+extern plant hal_host_plant;
+
+#endif
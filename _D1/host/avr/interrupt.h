@@ -0,0 +1,18 @@
+/* Host stand-in for <avr/interrupt.h>. Vectors become plain functions
+ * that hal_host.c calls as simulated time passes.
+ */
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+#include <stdint.h>
+
+extern volatile uint8_t hal_host_sreg_i;
+
+#define ISR_BLOCK
+#define ISR_NOBLOCK
+#define ISR(vector, ...)	void vector(void); void vector(void)
+
+#define sei()	(hal_host_sreg_i = 1)
+#define cli()	(hal_host_sreg_i = 0)
+
+#endif
@@ -0,0 +1,13 @@
+/* Host stand-in for <avr/pgmspace.h>, flash is ordinary memory */
+#ifndef HOST_AVR_PGMSPACE_H
+#define HOST_AVR_PGMSPACE_H
+
+#include <stdint.h>
+
+#define PROGMEM
+#define PGM_P			const char *
+#define PSTR(s)			(s)
+#define pgm_read_byte(addr)	(*(const uint8_t *)(addr))
+#define pgm_read_word(addr)	(*(const uint16_t *)(addr))
+
+#endif
@@ -0,0 +1,26 @@
+/* Host stand-in for <util/crc16.h>, same results as the avr-libc versions */
+#ifndef HOST_UTIL_CRC16_H
+#define HOST_UTIL_CRC16_H
+
+#include <stdint.h>
+
+static inline uint8_t _crc8_ccitt_update(uint8_t crc, uint8_t data)
+{
+	uint8_t i;
+	crc ^= data;
+	for (i = 0; i < 8; i++)
+		crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+	return crc;
+}
+
+/* CRC-16, poly 0xA001 (0x8005 reflected) */
+static inline uint16_t _crc16_update(uint16_t crc, uint8_t data)
+{
+	uint8_t i;
+	crc ^= data;
+	for (i = 0; i < 8; i++)
+		crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+	return crc;
+}
+
+#endif
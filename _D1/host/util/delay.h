@@ -0,0 +1,10 @@
+/* Host stand-in for <util/delay.h>, delays advance the simulated clock */
+#ifndef HOST_UTIL_DELAY_H
+#define HOST_UTIL_DELAY_H
+
+void hal_host_delay_us(double us);
+
+#define _delay_us(us)	hal_host_delay_us(us)
+#define _delay_ms(ms)	hal_host_delay_us((ms)*1000.0)
+
+#endif
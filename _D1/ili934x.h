@@ -87,6 +87,16 @@
 #define INTERNAL_IC_SETTING							0xCB
 #define GAMMA_DISABLE								0xF2
 
+#ifdef HOST
+/* The host build hands every bus write to the emulator in lcd_host.c */
+#include "lcd_host.h"
+#define write_cmd(cmd)		lcd_host_cmd(cmd)
+#define write_data(data)	lcd_host_data(data)
+#define write_hold(data)	lcd_host_hold(data)
+#define write_strobe()		lcd_host_strobe()
+#define read_data(d)		((d) = lcd_host_read())
+#define read_fmark()		lcd_host_fmark()
+#else
 #define write_cmd(cmd) \
 { \
 	RS_lo(); \
@@ -103,6 +113,31 @@
 	WR_hi(); \
 }
 
+/* Put a byte on the bus without a strobe, then clock it in as often as
+ * needed: for runs of one byte, e.g. a solid fill in BLACK or WHITE.
+ * Writing a one to a PIN bit toggles the port bit, one cycle each way.
+ */
+#define write_hold(data)	WRITE(data)
+#define write_strobe() \
+{ \
+	CTRL_PIN = _BV(WR); \
+	CTRL_PIN = _BV(WR); \
+}
+
+/* One read strobe, DATA_DDR must be 0x00. The panel drives the bus within
+ * 40 ns of RD falling; the nops cover that and the input synchroniser.
+ */
+#define read_data(d) \
+{ \
+	RD_lo(); \
+	asm volatile ("nop\n\tnop"); \
+	(d) = DATA_PIN; \
+	RD_hi(); \
+}
+
+#define read_fmark()		(CTRL_PIN & _BV(FMARK))
+#endif
+
 #define write_data16(data) \
 { \
 	write_data((data) >> 8); \
@@ -118,5 +153,23 @@
 		write_data(*d++); \
 }
 
+/* Controller start up in stages, with the datasheet minimum waits. Each
+ * init_display_stage(n), n from 0 to DISPLAY_STAGES-1, returns the ms the
+ * controller needs before the next one. The panel is then configured
+ * portrait (MADCTL 0x48) but still off; display_enable() turns it and the
+ * backlight on. init_display_controller() runs them all, clearing GRAM in
+ * between, and blocks for about 160 ms, 120 of them after the reset.
+ */
+#define DISPLAY_STAGES	3
+
 void init_display_controller();
+uint8_t init_display_stage(uint8_t n);
+void display_enable(void);
+
+/* Tearing effect output on FMARK, high through vertical blanking only, and
+ * the gate line the panel is refreshing: 0 to 319 for the display, then
+ * the porch lines, top to bottom of the panel whatever MADCTL says.
+ */
+void display_tearing(uint8_t on);
+uint16_t display_scanline(void);
 
@@ -4,7 +4,13 @@
 
 lcd display = {LCDWIDTH, LCDHEIGHT, East, 0, 0, WHITE, BLACK};
 
-void init_lcd()
+#define BOOT_ROWS	8	/* GRAM rows cleared per step, 1920 pixels */
+#define SCAN_LINES	(LCDHEIGHT + 4)	/* with the default porches */
+#define SYNC_POLLS	60000	/* gives up after well over a refresh */
+
+static uint8_t tear_sync;
+
+static void init_ports(void)
 {
 	/* Disable JTAG in software, so that it does not interfere with Port C  */
 	/* It will be re-enabled after a power cycle if the JTAGEN fuse is set. */
@@ -14,10 +20,41 @@ void init_lcd()
 	/* Configure ports */
 	CTRL_DDR = 0x7F;
 	DATA_DDR = 0xFF;
-	
+}
+
+void init_lcd()
+{
+	init_ports();
 	init_display_controller();
 }
 
+/* Controller stages, then GRAM a band at a time, then display on */
+uint8_t init_lcd_step(void)
+{
+	static uint8_t stage;
+	static uint16_t row;
+	rectangle r;
+
+	if (stage == 0)
+		init_ports();
+	if (stage < DISPLAY_STAGES)
+		return init_display_stage(stage++);
+	if (row < LCDHEIGHT) {
+		r.left = 0;
+		r.right = LCDWIDTH - 1;
+		r.top = row;
+		row += BOOT_ROWS;
+		r.bottom = row - 1;
+		fill_rectangle(r, BLACK);
+		return 0;
+	}
+	if (stage == DISPLAY_STAGES) {
+		display_enable();
+		stage++;
+	}
+	return LCD_READY;
+}
+
 void set_orientation(orientation o)
 {
 	display.orient = o;
@@ -50,31 +87,54 @@ void set_orientation(orientation o)
 	write_data16(display.height-1);
 }
 
-void fill_rectangle(rectangle r, uint16_t col)
+/* Sets the drawing window and starts a MEMORY_WRITE into it. The
+ * controller fills the window a row at a time, left to right.
+ */
+static void window(uint16_t left, uint16_t right, uint16_t top, uint16_t bottom)
 {
-	uint16_t x, y;
 	write_cmd(COLUMN_ADDRESS_SET);
-	write_data16(r.left);
-	write_data16(r.right);
+	write_data16(left);
+	write_data16(right);
 	write_cmd(PAGE_ADDRESS_SET);
-	write_data16(r.top);
-	write_data16(r.bottom);
+	write_data16(top);
+	write_data16(bottom);
 	write_cmd(MEMORY_WRITE);
-	for(x=r.left; x<=r.right; x++)
-		for(y=r.top; y<=r.bottom; y++)
-			write_data16(col);
+}
+
+#define FILL_PIXEL(h, l)	{ write_data(h); write_data(l); }
+#define FILL_STROBE2()		{ write_strobe(); write_strobe(); }
+
+/* Solid fills stream r's pixel count with no per-pixel bookkeeping. When
+ * both colour bytes are equal, as for BLACK and WHITE, the byte is put on
+ * the bus once and only WR is toggled. Loops are unrolled by 8 pixels.
+ */
+void fill_rectangle(rectangle r, uint16_t col)
+{
+	uint8_t h = col >> 8, l = col;
+	uint32_t n;
+	if (r.right < r.left || r.bottom < r.top) return;
+	n = (uint32_t)(r.right - r.left + 1) * (r.bottom - r.top + 1);
+	window(r.left, r.right, r.top, r.bottom);
+	if (h == l) {
+		write_hold(h);
+		for (; n >= 8; n -= 8) {
+			FILL_STROBE2(); FILL_STROBE2(); FILL_STROBE2(); FILL_STROBE2();
+			FILL_STROBE2(); FILL_STROBE2(); FILL_STROBE2(); FILL_STROBE2();
+		}
+		while (n--) FILL_STROBE2();
+	} else {
+		for (; n >= 8; n -= 8) {
+			FILL_PIXEL(h, l); FILL_PIXEL(h, l); FILL_PIXEL(h, l); FILL_PIXEL(h, l);
+			FILL_PIXEL(h, l); FILL_PIXEL(h, l); FILL_PIXEL(h, l); FILL_PIXEL(h, l);
+		}
+		while (n--) FILL_PIXEL(h, l);
+	}
 }
 
 void fill_rectangle_indexed(rectangle r, uint16_t* col)
 {
 	uint16_t x, y;
-	write_cmd(COLUMN_ADDRESS_SET);
-	write_data16(r.left);
-	write_data16(r.right);
-	write_cmd(PAGE_ADDRESS_SET);
-	write_data16(r.top);
-	write_data16(r.bottom);
-	write_cmd(MEMORY_WRITE);
+	window(r.left, r.right, r.top, r.bottom);
 	for(x=r.left; x<=r.right; x++)
 		for(y=r.top; y<=r.bottom; y++)
 			write_data16(*col++);
@@ -88,40 +148,136 @@ void clear_screen()
 	fill_rectangle(r, display.background);
 }
 
+/* One 6 pixel glyph row: 5 font columns from bit 0 up, then the gap */
+static void glyph_row(uint8_t bits, uint8_t fh, uint8_t fl, uint8_t bh, uint8_t bl)
+{
+	uint8_t i;
+	for (i = 0; i < 6; i++, bits >>= 1) {
+		if (bits & 1) {
+			write_data(fh);
+			write_data(fl);
+		} else {
+			write_data(bh);
+			write_data(bl);
+		}
+	}
+}
+
+/* Each glyph is one 6x8 window, streamed in a single MEMORY_WRITE */
 void display_char(char c)
 {
-	uint16_t x, y;
-	PGM_P fdata; 
-	uint8_t bits, mask;
-	uint16_t sc=display.x, ec=display.x + 4, sp=display.y, ep=display.y + 7;
+	PGM_P fdata;
+	uint8_t y;
+	uint8_t fh = display.foreground >> 8, fl = display.foreground;
+	uint8_t bh = display.background >> 8, bl = display.background;
 	if (c < 32 || c > 126) return;
-	fdata = (c - ' ')*5 + font5x7;
-	write_cmd(PAGE_ADDRESS_SET);
-	write_data16(sp);
-	write_data16(ep);
-	for(x=sc; x<=ec; x++) {
-		write_cmd(COLUMN_ADDRESS_SET);
-		write_data16(x);
-		write_data16(x);
-		write_cmd(MEMORY_WRITE);
-		bits = pgm_read_byte(fdata++);
-		for(y=sp, mask=0x01; y<=ep; y++, mask<<=1)
-			write_data16((bits & mask) ? display.foreground : display.background);
-	}
-	write_cmd(COLUMN_ADDRESS_SET);
-	write_data16(x);
-	write_data16(x);
-	write_cmd(MEMORY_WRITE);
-	for(y=sp; y<=ep; y++)
-		write_data16(display.background);
+	fdata = (c - ' ')*8 + (PGM_P)font5x7_rows;
+	window(display.x, display.x + 5, display.y, display.y + 7);
+	for (y = 0; y < 8; y++)
+		glyph_row(pgm_read_byte(fdata++), fh, fl, bh, bl);
 
 	display.x += 6;
 	if (display.x >= display.width) { display.x=0; display.y+=8; }
 }
 
+/* A string that fits on the line goes out as one window, row by row
+ * across all its glyphs; otherwise it falls back to display_char().
+ */
 void display_string(char *str)
 {
-	uint8_t i;
-	for(i=0; str[i]; i++) 
-		display_char(str[i]);
+	uint8_t i, n, y;
+	uint8_t fh = display.foreground >> 8, fl = display.foreground;
+	uint8_t bh = display.background >> 8, bl = display.background;
+	PGM_P row;
+
+	for (n = 0; str[n]; n++)
+		if (str[n] < 32 || str[n] > 126 || n == 255) break;
+	if (str[n] || n == 0 || display.x + 6*n > display.width) {
+		for (i = 0; str[i]; i++)
+			display_char(str[i]);
+		return;
+	}
+
+	window(display.x, display.x + 6*n - 1, display.y, display.y + 7);
+	for (y = 0; y < 8; y++) {
+		row = (PGM_P)font5x7_rows + y;
+		for (i = 0; i < n; i++)
+			glyph_row(pgm_read_byte(row + (str[i] - ' ')*8), fh, fl, bh, bl);
+	}
+
+	display.x += 6*n;
+	if (display.x >= display.width) { display.x=0; display.y+=8; }
+}
+
+void lcd_tear_sync(uint8_t on)
+{
+	tear_sync = on;
+	display_tearing(on);
+}
+
+uint16_t lcd_scanline(void)
+{
+	return display_scanline();
+}
+
+uint8_t lcd_frame_wait(void)
+{
+	uint16_t n = SYNC_POLLS;
+	if (!tear_sync)
+		return 0;
+	while (read_fmark() && --n);
+	while (n && !read_fmark() && --n);
+	return n != 0;
+}
+
+/* The lines r covers, in scan order, for the MADCTL set_orientation() uses */
+static void scan_lines(rectangle r, uint16_t *first, uint16_t *last)
+{
+	switch (display.orient) {
+	case North:
+		*first = r.top;
+		*last = r.bottom;
+		break;
+	case South:
+		*first = LCDHEIGHT-1 - r.bottom;
+		*last = LCDHEIGHT-1 - r.top;
+		break;
+	case East:
+		*first = r.left;
+		*last = r.right;
+		break;
+	default:	/* West */
+		*first = LCDHEIGHT-1 - r.right;
+		*last = LCDHEIGHT-1 - r.left;
+		break;
+	}
+}
+
+uint8_t lcd_clear(rectangle r)
+{
+	uint16_t first, last;
+	int16_t line;
+
+	if (!tear_sync)
+		return 1;
+	line = display_scanline();
+	scan_lines(r, &first, &last);
+	if (last - first + LCD_SYNC_LINES >= LCDHEIGHT)
+		return line >= LCDHEIGHT;
+	if (line > (int16_t)last)
+		line -= SCAN_LINES;	/* past r, count from the next refresh */
+	return line + LCD_SYNC_LINES < (int16_t)first;
+}
+
+void lcd_sync(rectangle r)
+{
+	uint16_t first, last, n = SYNC_POLLS;
+
+	if (!tear_sync)
+		return;
+	scan_lines(r, &first, &last);
+	if (last - first + LCD_SYNC_LINES >= LCDHEIGHT)
+		lcd_frame_wait();
+	else
+		while (!lcd_clear(r) && --n);
 }
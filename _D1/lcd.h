@@ -1,3 +1,6 @@
+#ifndef LCD_H
+#define LCD_H
+
 #include <stdint.h>
 
 #define LCDWIDTH	240
@@ -30,10 +33,38 @@ typedef struct {
 	uint16_t top, bottom;
 } rectangle;	
 
+/* init_lcd() blocks for about 160 ms. init_lcd_step() does the same one
+ * step per call, none longer than about 1 ms of bus traffic, and returns
+ * the ms to wait before the next call, or LCD_READY once the panel is on.
+ * Either leaves the orientation to set_orientation().
+ */
+#define LCD_READY	0xFF
+
 void init_lcd();
+uint8_t init_lcd_step(void);
 void set_orientation(orientation o);
 void clear_screen();
 void fill_rectangle(rectangle r, uint16_t col);
 void fill_rectangle_indexed(rectangle r, uint16_t* col);
 void display_char(char c);
 void display_string(char *str);
+
+/* Tear sync. With it on, lcd_clear(r) says whether the panel's scan is
+ * clear of r, just past its last line or at least LCD_SYNC_LINES short of
+ * its first, so that an update drawn now lands on the glass whole if it
+ * takes less than a refresh; lcd_sync(r) waits for that. Small rectangles
+ * rarely wait at all, and never for more than their height in lines. A
+ * rectangle too tall to ever be clear is clear only in vertical blanking,
+ * and lcd_sync() waits for the FMARK edge that starts it, as
+ * lcd_frame_wait() does; that returns 0 when sync is off or no edge came.
+ * With sync off every rectangle is clear and nothing waits.
+ */
+#define LCD_SYNC_LINES	8	/* about 350 us of scan, 170 glyph pixels */
+
+void lcd_tear_sync(uint8_t on);
+uint16_t lcd_scanline(void);
+uint8_t lcd_frame_wait(void);
+uint8_t lcd_clear(rectangle r);
+void lcd_sync(rectangle r);
+
+#endif
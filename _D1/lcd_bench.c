@@ -0,0 +1,322 @@
+/*   lcd_bench.c
+ *
+ *   Host benchmark of text rendering and fills against the LCD bus
+ *   emulator in lcd_host.c. Draws the same status line through the old
+ *   column-per-window display_char(), the burst display_char() and the
+ *   single window display_string(), and reports bus strobes per glyph and
+ *   pixels per second. Then clears the screen through the old per-pixel
+ *   fill_rectangle() and the current one, in BLACK and in BLUE, whose
+ *   bytes differ and so miss the strobe-only path. Last, pixels written
+ *   per frame for game.c's ball and bat, erased and redrawn whole as
+ *   before, and as sprite.c deltas. Last, those sprites at 60 frames/s and
+ *   embedded_boost.c's 1 kHz wave chart from a main loop passing every
+ *   LOOP_US, with lcd_tear_sync() off and on: the updates the emulator saw
+ *   reach the glass over two refreshes, and the time spent on the scan.
+ *
+ *   Two rates are given: host, the emulator throughput on this machine,
+ *   and avr, the bus-bound rate at F_CPU with a data strobe costing
+ *   AVR_DATA_CYCLES (out, cbi, sbi), a bare strobe AVR_STROBE_CYCLES (two
+ *   PIN writes) and a command AVR_CMD_CYCLES. Text leaves out loop
+ *   overhead, so it is an upper bound; fills add the loop cycles per
+ *   pixel of each version's inner loop.
+ *
+ *   make lcd_bench
+ *   ./lcd_bench [lines]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#include "ili934x.h"
+#include "font.h"
+#include "lcd.h"
+#include "sprite.h"
+#include "wave.h"
+#include "hal_host.h"
+#include <util/delay.h>
+
+#define AVR_DATA_CYCLES	5
+#define AVR_CMD_CYCLES	9
+#define AVR_STROBE_CYCLES	2
+
+/* Loop cycles per pixel: 16-bit y increment, compare and branch for the
+ * old fill, 32-bit subtract and branch per 8 pixels for the new one.
+ */
+#define LOOP_US		250	/* embedded_boost.c main loop pass, about */
+
+#define OLD_FILL_LOOP	6.0
+#define NEW_FILL_LOOP	(7.0/8)
+
+static const char *line = "Vout =  10.023V  kP = 0.001500";
+
+/* display_char() before the burst path: one window per glyph column,
+ * from the column-major font it used, rebuilt here from font5x7_rows.
+ */
+static uint8_t font_cols[95*5];
+
+static void make_font_cols(void)
+{
+	int c, x, y;
+	for (c = 0; c < 95; c++)
+		for (x = 0; x < 5; x++) {
+			uint8_t b = 0;
+			for (y = 0; y < 8; y++)
+				if (font5x7_rows[c*8 + y] & (1 << x))
+					b |= 1 << y;
+			font_cols[c*5 + x] = b;
+		}
+}
+
+static void column_char(char c)
+{
+	uint16_t x, y;
+	const uint8_t *fdata;
+	uint8_t bits, mask;
+	uint16_t sc=display.x, ec=display.x + 4, sp=display.y, ep=display.y + 7;
+	if (c < 32 || c > 126) return;
+	fdata = (c - ' ')*5 + font_cols;
+	write_cmd(PAGE_ADDRESS_SET);
+	write_data16(sp);
+	write_data16(ep);
+	for(x=sc; x<=ec; x++) {
+		write_cmd(COLUMN_ADDRESS_SET);
+		write_data16(x);
+		write_data16(x);
+		write_cmd(MEMORY_WRITE);
+		bits = *fdata++;
+		for(y=sp, mask=0x01; y<=ep; y++, mask<<=1)
+			write_data16((bits & mask) ? display.foreground : display.background);
+	}
+	write_cmd(COLUMN_ADDRESS_SET);
+	write_data16(x);
+	write_data16(x);
+	write_cmd(MEMORY_WRITE);
+	for(y=sp; y<=ep; y++)
+		write_data16(display.background);
+
+	display.x += 6;
+	if (display.x >= display.width) { display.x=0; display.y+=8; }
+}
+
+static void column_string(char *s)
+{
+	while (*s) column_char(*s++);
+}
+
+static void burst_chars(char *s)
+{
+	while (*s) display_char(*s++);
+}
+
+/* fill_rectangle() before the fast path */
+static void old_fill(rectangle r, uint16_t col)
+{
+	uint16_t x, y;
+	write_cmd(COLUMN_ADDRESS_SET);
+	write_data16(r.left);
+	write_data16(r.right);
+	write_cmd(PAGE_ADDRESS_SET);
+	write_data16(r.top);
+	write_data16(r.bottom);
+	write_cmd(MEMORY_WRITE);
+	for(x=r.left; x<=r.right; x++)
+		for(y=r.top; y<=r.bottom; y++)
+			write_data16(col);
+}
+
+static double now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+static void run(const char *name, void (*draw)(char *), int lines)
+{
+	char buf[64];
+	double t0, t;
+	uint32_t glyphs = strlen(line)*(uint32_t)lines;
+	double avr;
+	int i;
+
+	strcpy(buf, line);
+	memset(&lcd_host_count, 0, sizeof(lcd_host_count));
+	t0 = now();
+	for (i = 0; i < lines; i++) {
+		display.x = 0;
+		display.y = (i % 30)*8;
+		draw(buf);
+	}
+	t = now() - t0;
+	avr = (double)lcd_host_count.data*AVR_DATA_CYCLES + (double)lcd_host_count.cmds*AVR_CMD_CYCLES;
+	printf("%-16s %7.1f strobes/glyph %5.1f cmds/glyph %8.2f Mpixel/s host %8.0f kpixel/s avr\n",
+		name, (double)(lcd_host_count.cmds + lcd_host_count.data)/glyphs,
+		(double)lcd_host_count.cmds/glyphs, lcd_host_count.pixels/t/1e6,
+		lcd_host_count.pixels/(avr/F_CPU)/1e3);
+}
+
+static void run_fill(const char *name, void (*fill)(rectangle, uint16_t),
+	uint16_t col, double loop, int frames)
+{
+	rectangle r = {0, display.width-1, 0, display.height-1};
+	double t0, t, avr;
+	uint32_t bare;
+	int i;
+
+	memset(&lcd_host_count, 0, sizeof(lcd_host_count));
+	t0 = now();
+	for (i = 0; i < frames; i++)
+		fill(r, col);
+	t = now() - t0;
+	/* a strobe without its own port load is a bare WR toggle */
+	bare = lcd_host_count.cmds + lcd_host_count.data - lcd_host_count.loads;
+	avr = (double)(lcd_host_count.data - bare)*AVR_DATA_CYCLES
+		+ (double)bare*AVR_STROBE_CYCLES
+		+ (double)lcd_host_count.cmds*AVR_CMD_CYCLES
+		+ (double)lcd_host_count.pixels*loop;
+	printf("%-16s %7.2f loads/pixel %8.2f Mpixel/s host %8.1f ms/clear avr\n",
+		name, (double)lcd_host_count.loads/lcd_host_count.pixels,
+		lcd_host_count.pixels/t/1e6, avr/F_CPU*1e3/frames);
+}
+
+/* Ball 6x6 at 100/60 pixels a frame each way, bat 51x4 moving 5 a frame */
+static void run_sprites(int frames)
+{
+	sprite ball, bat;
+	uint32_t old_px, new_px;
+	int i;
+
+	sprite_init(&ball, 20, 20, 6, 6, MAGENTA);
+	sprite_init(&bat, 20, 200, 51, 4, WHITE);
+	ball.vx = ball.vy = SPRITE_PX(100.0/60);
+	bat.vx = SPRITE_PX(5);
+	sprite_draw(&ball);
+	sprite_draw(&bat);
+
+	memset(&lcd_host_count, 0, sizeof(lcd_host_count));
+	for (i = 0; i < frames; i++) {
+		fill_rectangle(sprite_rect(&ball), BLACK);
+		fill_rectangle(sprite_rect(&bat), BLACK);
+		sprite_step(&ball);
+		sprite_step(&bat);
+		fill_rectangle(sprite_rect(&ball), MAGENTA);
+		fill_rectangle(sprite_rect(&bat), WHITE);
+		if (sprite_rect(&ball).bottom > 150) ball.vy = -ball.vy, ball.vx = -ball.vx;
+		if (sprite_rect(&bat).right > 200 || bat.x < SPRITE_PX(10)) bat.vx = -bat.vx;
+	}
+	old_px = lcd_host_count.pixels;
+
+	sprite_place(&ball, 20, 20);
+	sprite_place(&bat, 20, 200);
+	ball.vx = ball.vy = SPRITE_PX(100.0/60);
+	bat.vx = SPRITE_PX(5);
+	sprite_draw(&ball);
+	sprite_draw(&bat);
+	memset(&lcd_host_count, 0, sizeof(lcd_host_count));
+	for (i = 0; i < frames; i++) {
+		sprite_step(&ball);
+		sprite_step(&bat);
+		sprite_draw(&ball);
+		sprite_draw(&bat);
+		if (sprite_rect(&ball).bottom > 150) ball.vy = -ball.vy, ball.vx = -ball.vx;
+		if (sprite_rect(&bat).right > 200 || bat.x < SPRITE_PX(10)) bat.vx = -bat.vx;
+	}
+	new_px = lcd_host_count.pixels;
+	printf("%-16s %7.1f pixels/frame\n", "erase and draw", (double)old_px/frames);
+	printf("%-16s %7.1f pixels/frame\n", "sprite deltas", (double)new_px/frames);
+}
+
+static sprite ball, bat;
+
+static void sprites_init(void)
+{
+	sprite_init(&ball, 20, 20, 6, 6, MAGENTA);
+	sprite_init(&bat, 20, 200, 51, 4, WHITE);
+	ball.vx = ball.vy = SPRITE_PX(100.0/60);
+	bat.vx = SPRITE_PX(5);
+}
+
+static void sprites_pass(void)
+{
+	sprite_step(&ball);
+	sprite_step(&bat);
+	lcd_host_update();
+	sprite_draw(&ball);
+	lcd_host_update();
+	sprite_draw(&bat);
+	if (sprite_rect(&ball).bottom > 150 || ball.y < SPRITE_PX(10)) ball.vy = -ball.vy;
+	if (sprite_rect(&ball).right > 200 || ball.x < SPRITE_PX(10)) ball.vx = -ball.vx;
+	if (sprite_rect(&bat).right > 200 || bat.x < SPRITE_PX(10)) bat.vx = -bat.vx;
+}
+
+/* embedded_boost.c's band, a 7 Hz sine sampled at 1 kHz, 4 samples a row */
+static chart trend;
+static wave trace;
+static wave_bucket history[278];
+static uint64_t next_sample;
+static uint32_t samples;
+
+static void wave_setup(void)
+{
+	chart_init(&trend, 22, 299, display.width/8, 32);
+	wave_init(&trace, history, 278, 4);
+	next_sample = hal_host_ns;
+}
+
+static void wave_pass(void)
+{
+	for (; next_sample <= hal_host_ns; next_sample += 1000000, samples++)
+		wave_sample(&trace, 128 + 100*sin(samples*2*M_PI*7/1000));
+	lcd_host_update();
+	wave_draw(&trace, &trend);
+}
+
+static void run_tear(const char *name, void (*init)(void), void (*pass)(void),
+	double period_us, uint8_t sync, int passes)
+{
+	uint64_t t, wait = 0, most = 0;
+	int i;
+
+	set_orientation(North);
+	lcd_tear_sync(sync);
+	init();
+	for (i = -passes/10; i < passes; i++) {
+		if (i == 0) {
+			memset(&lcd_host_count, 0, sizeof(lcd_host_count));
+			wait = most = 0;
+		}
+		hal_host_delay_us(period_us);
+		t = hal_host_ns;
+		pass();
+		t = hal_host_ns - t;
+		wait += t;
+		if (t > most) most = t;
+	}
+	printf("%-16s %7.2f%% torn %7.1f us/pass on the scan %6.1f us max\n",
+		name, 100.0*lcd_host_count.torn/lcd_host_count.updates,
+		wait/1e3/passes, most/1e3);
+}
+
+int main(int argc, char **argv)
+{
+	int lines = argc > 1 ? atoi(argv[1]) : 20000;
+
+	make_font_cols();
+	set_orientation(East);
+	run("column windows", column_string, lines);
+	run("glyph window", burst_chars, lines);
+	run("string window", display_string, lines);
+	run_fill("old fill BLACK", old_fill, BLACK, OLD_FILL_LOOP, lines/100);
+	run_fill("fill BLACK", fill_rectangle, BLACK, NEW_FILL_LOOP, lines/100);
+	run_fill("old fill BLUE", old_fill, BLUE, OLD_FILL_LOOP, lines/100);
+	run_fill("fill BLUE", fill_rectangle, BLUE, NEW_FILL_LOOP, lines/100);
+	run_sprites(lines);
+	run_tear("sprites", sprites_init, sprites_pass, 1e6/60, 0, lines/10);
+	run_tear("sprites synced", sprites_init, sprites_pass, 1e6/60, 1, lines/10);
+	run_tear("wave", wave_setup, wave_pass, LOOP_US, 0, lines);
+	run_tear("wave synced", wave_setup, wave_pass, LOOP_US, 1, lines);
+	return 0;
+}
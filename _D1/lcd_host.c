@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <util/delay.h>
+#include "hal_host.h"
+#include "lcd_host.h"
+
+/* Commands the emulator decodes, as in ili934x.h */
+#define COLUMN_ADDRESS_SET			0x2A
+#define PAGE_ADDRESS_SET			0x2B
+#define MEMORY_WRITE				0x2C
+#define VERTICAL_SCROLLING_DEFINITION		0x33
+#define TEARING_EFFECT_LINE_OFF			0x34
+#define TEARING_EFFECT_LINE_ON			0x35
+#define MEMORY_ACCESS_CONTROL			0x36
+#define VERTICAL_SCROLLING_START_ADDRESS	0x37
+#define WRITE_MEMORY_CONTINUE			0x3C
+#define GET_SCANLINE				0x45
+
+#define MADCTL_MY	0x80
+#define MADCTL_MX	0x40
+#define MADCTL_MV	0x20
+
+lcd_host_bus lcd_host_count;
+lcd_host_frame_count lcd_host_frames;
+uint16_t lcd_host_gram[LCD_HOST_ROWS][LCD_HOST_COLS];
+
+static uint8_t cmd, bus, param[6], nparam;
+static uint8_t madctl;
+static uint16_t sc, ec = LCD_HOST_COLS - 1, sp, ep = LCD_HOST_ROWS - 1;	/* window */
+static uint16_t col, page;	/* write pointer, within the window */
+static uint16_t tfa, vsa = LCD_HOST_ROWS, vsp;	/* scrolling */
+static uint8_t half, hi_byte;
+static uint8_t te_on, nread;
+static uint16_t read_line;
+static uint64_t bus_base;	/* simulated time the bus time counts from */
+static uint32_t bus_ns;
+static uint64_t update_refresh;	/* the refresh the update's pixels are in */
+static uint32_t update_lines;
+static uint8_t update_torn;
+static uint8_t grouped;		/* updates are lcd_host_update() calls apart */
+static uint32_t frame_start;
+static const char *ppm_path;
+static uint8_t stats;
+
+static uint16_t get16(uint8_t i)
+{
+	return (uint16_t)param[i] << 8 | param[i + 1];
+}
+
+/* Column and page address to frame memory, for the current MADCTL. In
+ * North (MX only) they are the panel's own x and y; MX clear mirrors x
+ * because of how the panel is wired.
+ */
+static void to_panel(uint16_t c, uint16_t p, uint16_t *x, uint16_t *y)
+{
+	if (madctl & MADCTL_MV) {
+		*x = p;
+		*y = c;
+	} else {
+		*x = c;
+		*y = p;
+	}
+	if (!(madctl & MADCTL_MX)) *x = LCD_HOST_COLS - 1 - *x;
+	if (madctl & MADCTL_MY) *y = LCD_HOST_ROWS - 1 - *y;
+}
+
+/* Panel time, which runs ahead of the simulation by the bus time */
+static void bus_strobe(void)
+{
+	if (hal_host_ns != bus_base) {
+		bus_base = hal_host_ns;
+		bus_ns = 0;
+	}
+	bus_ns += LCD_HOST_STROBE_NS;
+}
+
+/* Lines the panel has refreshed since start up */
+static uint64_t scanned(void)
+{
+	uint64_t ns = hal_host_ns == bus_base ? bus_base + bus_ns : hal_host_ns;
+	return ns*(LCD_HOST_HZ*LCD_HOST_LINES)/1000000000u;
+}
+
+/* The line frame memory row y is shown on, with scrolling applied */
+static uint16_t row_line(uint16_t y)
+{
+	if (vsa && y >= tfa && y < tfa + vsa)
+		return tfa + (y - vsp + vsa) % vsa;
+	return y;
+}
+
+/* A change to a line reaches the glass in this refresh if the scan has
+ * yet to get there, otherwise in the next.
+ */
+static void scan_check(uint16_t line)
+{
+	uint64_t n = scanned();
+	uint64_t refresh = n/LCD_HOST_LINES + (line > n % LCD_HOST_LINES ? 0 : 1);
+	if (update_lines++ == 0) {
+		lcd_host_count.updates++;
+		update_refresh = refresh;
+	} else if (refresh != update_refresh && !update_torn) {
+		lcd_host_count.torn++;
+		update_torn = 1;
+	}
+}
+
+void lcd_host_update(void)
+{
+	grouped = 1;
+	update_lines = 0;
+	update_torn = 0;
+}
+
+static void put_pixel(uint16_t rgb)
+{
+	uint16_t x, y;
+	to_panel(col, page, &x, &y);
+	if (x < LCD_HOST_COLS && y < LCD_HOST_ROWS) {
+		lcd_host_gram[y][x] = rgb;
+		scan_check(row_line(y));
+	}
+	lcd_host_count.pixels++;
+	if (col++ >= ec) {
+		col = sc;
+		if (page++ >= ep)
+			page = sp;
+	}
+}
+
+/* Parameters are acted on once the last one has arrived */
+static void param_byte(uint8_t d)
+{
+	if (nparam < sizeof(param))
+		param[nparam++] = d;
+	switch (cmd) {
+	case COLUMN_ADDRESS_SET:
+		if (nparam == 4) { sc = get16(0); ec = get16(2); }
+		break;
+	case PAGE_ADDRESS_SET:
+		if (nparam == 4) { sp = get16(0); ep = get16(2); }
+		break;
+	case MEMORY_ACCESS_CONTROL:
+		if (nparam == 1) madctl = d;
+		break;
+	case VERTICAL_SCROLLING_DEFINITION:
+		if (nparam == 6) { tfa = get16(0); vsa = get16(2); }
+		break;
+	case VERTICAL_SCROLLING_START_ADDRESS:
+		/* moves the whole area, the lines either side of the scan
+		 * in different refreshes
+		 */
+		if (nparam == 2) {
+			vsp = get16(0);
+			scan_check(tfa);
+			scan_check(tfa + vsa - 1);
+		}
+		break;
+	case TEARING_EFFECT_LINE_ON:
+		if (nparam == 1) te_on = 1;	/* V-blank only, whatever the mode */
+		break;
+	}
+}
+
+void lcd_host_cmd(uint8_t c)
+{
+	lcd_host_count.cmds++;
+	lcd_host_count.loads++;
+	bus_strobe();
+	bus = cmd = c;
+	nparam = nread = 0;
+	half = 0;
+	if (c == MEMORY_WRITE) {
+		col = sc;
+		page = sp;
+		if (!grouped) {
+			update_lines = 0;
+			update_torn = 0;
+		}
+	}
+	if (c == TEARING_EFFECT_LINE_OFF)
+		te_on = 0;
+}
+
+void lcd_host_strobe(void)
+{
+	lcd_host_count.data++;
+	bus_strobe();
+	if (cmd != MEMORY_WRITE && cmd != WRITE_MEMORY_CONTINUE) {
+		param_byte(bus);
+		return;
+	}
+	if ((half ^= 1))
+		hi_byte = bus;
+	else
+		put_pixel((uint16_t)hi_byte << 8 | bus);
+}
+
+void lcd_host_hold(uint8_t d)
+{
+	lcd_host_count.loads++;
+	bus = d;
+}
+
+void lcd_host_data(uint8_t d)
+{
+	lcd_host_hold(d);
+	lcd_host_strobe();
+}
+
+/* GET_SCANLINE latches the line on its first real byte */
+uint8_t lcd_host_read(void)
+{
+	uint8_t d = 0;
+	lcd_host_count.reads++;
+	hal_host_delay_us(LCD_HOST_READ_NS/1000.0);
+	if (cmd == GET_SCANLINE) {
+		if (nread == 1) {
+			read_line = scanned() % LCD_HOST_LINES;
+			d = read_line >> 8;
+		} else if (nread == 2) {
+			d = read_line;
+		}
+		nread++;
+	}
+	return d;
+}
+
+uint8_t lcd_host_fmark(void)
+{
+	hal_host_delay_us(LCD_HOST_PIN_NS/1000.0);
+	return te_on && scanned() % LCD_HOST_LINES >= LCD_HOST_ROWS;
+}
+
+void lcd_host_frame(void)
+{
+	uint32_t strobes = lcd_host_count.cmds + lcd_host_count.data;
+	lcd_host_frame_count *f = &lcd_host_frames;
+	f->last = strobes - frame_start;
+	if (f->last > f->max) f->max = f->last;
+	f->total += f->last;
+	f->frames++;
+	frame_start = strobes;
+}
+
+uint16_t lcd_host_width(void)
+{
+	return madctl & MADCTL_MV ? LCD_HOST_ROWS : LCD_HOST_COLS;
+}
+
+uint16_t lcd_host_height(void)
+{
+	return madctl & MADCTL_MV ? LCD_HOST_COLS : LCD_HOST_ROWS;
+}
+
+/* The pixel seen at x, y of the current orientation. Rows of the
+ * scrolling area show frame memory from vsp on, wrapping within it.
+ */
+uint16_t lcd_host_pixel(uint16_t x, uint16_t y)
+{
+	uint16_t px, py;
+	to_panel(x, y, &px, &py);
+	if (px >= LCD_HOST_COLS || py >= LCD_HOST_ROWS)
+		return 0;
+	if (py >= tfa && py < tfa + vsa && vsa)
+		py = tfa + (py - tfa + vsp - tfa + vsa) % vsa;
+	return lcd_host_gram[py][px];
+}
+
+int lcd_host_ppm(const char *path)
+{
+	uint16_t w = lcd_host_width(), h = lcd_host_height(), x, y, p;
+	FILE *f = fopen(path, "wb");
+	if (!f)
+		return -1;
+	fprintf(f, "P6\n%u %u\n255\n", w, h);
+	for (y = 0; y < h; y++)
+		for (x = 0; x < w; x++) {
+			p = lcd_host_pixel(x, y);
+			/* 5 and 6 bit fields widened to 8, top bits repeated */
+			fputc((p >> 8 & 0xF8) | p >> 13, f);
+			fputc((p >> 3 & 0xFC) | (p >> 9 & 0x03), f);
+			fputc((p << 3 & 0xF8) | (p >> 2 & 0x07), f);
+		}
+	return fclose(f);
+}
+
+static void report(void)
+{
+	lcd_host_frame_count *f = &lcd_host_frames;
+	if (ppm_path && lcd_host_ppm(ppm_path))
+		perror(ppm_path);
+	if (stats)
+		fprintf(stderr, "lcd_host: %u cmds, %u data, %u loads, %u pixels, "
+			"%u reads, %u of %u updates torn, "
+			"%u frames, %.0f strobes/frame mean, %u max, %u last\n",
+			lcd_host_count.cmds, lcd_host_count.data, lcd_host_count.loads,
+			lcd_host_count.pixels, lcd_host_count.reads,
+			lcd_host_count.torn, lcd_host_count.updates, f->frames,
+			f->frames ? (double)f->total/f->frames : 0.0, f->max, f->last);
+}
+
+__attribute__((constructor))
+static void lcd_host_init(void)
+{
+	ppm_path = getenv("LCD_PPM");
+	stats = getenv("LCD_STATS") != NULL;
+	if (ppm_path || stats)
+		atexit(report);
+}
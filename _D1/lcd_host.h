@@ -0,0 +1,84 @@
+#ifndef LCD_HOST_H
+#define LCD_HOST_H
+
+#include <stdint.h>
+
+/* Host side of the LCD bus: an ILI934x emulator.
+ *
+ * In host builds ili934x.h routes write_cmd(), write_data(), write_hold()
+ * and write_strobe() here instead of to the port pins. Every call but
+ * write_hold() is one WR strobe on the panel; every call but
+ * write_strobe() loads DATA_PORT.
+ *
+ * The byte stream is decoded into a 240x320 RGB565 frame memory, in the
+ * panel's own portrait layout. Decoded: COLUMN_ADDRESS_SET,
+ * PAGE_ADDRESS_SET, MEMORY_WRITE, WRITE_MEMORY_CONTINUE,
+ * MEMORY_ACCESS_CONTROL (MY, MX, MV), VERTICAL_SCROLLING_DEFINITION and
+ * VERTICAL_SCROLLING_START_ADDRESS, TEARING_EFFECT_LINE_ON and OFF, and
+ * GET_SCANLINE for lcd_host_read(); everything else only counts strobes.
+ * lcd_host_pixel() and lcd_host_ppm() show the panel as it is seen, with
+ * scrolling applied, turned to the current orientation.
+ *
+ * hal_idle() ends a frame each main loop pass, and lcd_host_frames keeps
+ * the strobes per frame.
+ *
+ * The panel refreshes LCD_HOST_LINES lines at LCD_HOST_HZ, as configured
+ * by init_display_stage(), on a clock that is the simulated time plus
+ * LCD_HOST_STROBE_NS per strobe since that last moved: drawing takes bus
+ * time on the AVR but none in the simulation. Reads and lcd_host_fmark()
+ * do advance the simulated time, so a loop polling them gets somewhere.
+ * An update counts as torn when what it changes reaches the glass over
+ * two refreshes, the scan having caught up with it; moving the scroll
+ * start changes every line of the scrolling area. An update is one
+ * MEMORY_WRITE burst, or once lcd_host_update() has been called, all the
+ * drawing from one call to the next.
+ *
+ * Environment, read at start up:
+ *   LCD_PPM    write the panel to this file as a binary PPM at exit
+ *   LCD_STATS  print the bus counts to stderr at exit
+ */
+
+#define LCD_HOST_COLS	240	/* panel columns */
+#define LCD_HOST_ROWS	320	/* panel rows, the vertical scrolling axis */
+#define LCD_HOST_LINES	324	/* rows plus 2 front and 2 back porch lines */
+#define LCD_HOST_HZ	70	/* FRAME_CONTROL_IN_NORMAL_MODE 0x00 0x1B */
+#define LCD_HOST_STROBE_NS	500	/* a write_data() at F_CPU */
+#define LCD_HOST_READ_NS	1000	/* a read_data() with its loop share */
+#define LCD_HOST_PIN_NS		500	/* one pass of a loop polling FMARK */
+
+typedef struct {
+	uint32_t cmds;		/* strobes with RS low */
+	uint32_t data;		/* strobes with RS high */
+	uint32_t loads;		/* writes to DATA_PORT */
+	uint32_t pixels;	/* 16-bit pixels written to frame memory */
+	uint32_t reads;		/* strobes on RD */
+	uint32_t updates;	/* bursts or groups, see lcd_host_update() */
+	uint32_t torn;		/* of them, shown over two refreshes */
+} lcd_host_bus;
+
+typedef struct {
+	uint32_t frames;	/* lcd_host_frame() calls */
+	uint32_t last;		/* strobes in the last frame */
+	uint32_t max;		/* most strobes in one frame */
+	uint64_t total;		/* strobes in all frames */
+} lcd_host_frame_count;
+
+extern lcd_host_bus lcd_host_count;
+extern lcd_host_frame_count lcd_host_frames;
+extern uint16_t lcd_host_gram[LCD_HOST_ROWS][LCD_HOST_COLS];
+
+void lcd_host_cmd(uint8_t cmd);
+void lcd_host_data(uint8_t data);
+void lcd_host_hold(uint8_t data);
+void lcd_host_strobe(void);
+uint8_t lcd_host_read(void);
+uint8_t lcd_host_fmark(void);
+void lcd_host_update(void);
+
+void lcd_host_frame(void);
+uint16_t lcd_host_width(void);
+uint16_t lcd_host_height(void);
+uint16_t lcd_host_pixel(uint16_t x, uint16_t y);
+int lcd_host_ppm(const char *path);
+
+#endif
@@ -0,0 +1,114 @@
+#include <util/crc16.h>
+#include "params.h"
+
+#define BODY	(PARAMS_SLOT - 2)	/* bytes under the CRC */
+
+static uint8_t image[PARAMS_SLOT];	/* block being written */
+static uint8_t pos = PARAMS_SLOT;	/* next byte of image, PARAMS_SLOT when done */
+static uint8_t slot = PARAMS_SLOTS - 1;	/* newest block */
+static uint16_t seq;
+static params next;
+static uint8_t pending;
+
+static uint16_t crc16(const uint8_t *b, uint8_t n)
+{
+	uint16_t crc = 0xFFFF;
+	while (n--)
+		crc = _crc16_update(crc, *b++);
+	return crc;
+}
+
+static uint8_t *put16(uint8_t *b, uint16_t x)
+{
+	b[0] = x;
+	b[1] = x >> 8;
+	return b + 2;
+}
+
+static uint8_t *put32(uint8_t *b, uint32_t x)
+{
+	return put16(put16(b, x), x >> 16);
+}
+
+static uint16_t get16(const uint8_t *b)
+{
+	return b[0] | (uint16_t)b[1] << 8;
+}
+
+static uint32_t get32(const uint8_t *b)
+{
+	return get16(b) | (uint32_t)get16(b + 2) << 16;
+}
+
+static void pack(uint8_t *b, const params *p, uint16_t s)
+{
+	b[0] = PARAMS_MAGIC;
+	b[1] = PARAMS_VERSION;
+	put16(b + 2, s);
+	put16(b + 4, p->target);
+	put32(b + 6, p->kP);
+	put32(b + 10, p->kI);
+	put32(b + 14, p->kD);
+	put16(b + BODY, crc16(b, BODY));
+}
+
+uint8_t params_load(params *p)
+{
+	uint8_t b[PARAMS_SLOT], i, j, found = 0;
+	uint16_t a, s;
+
+	for (i = 0; i < PARAMS_SLOTS; i++) {
+		a = i*PARAMS_SLOT;
+		if (hal_eeprom_read(a) != PARAMS_MAGIC || hal_eeprom_read(a + 1) != PARAMS_VERSION)
+			continue;
+		s = hal_eeprom_read(a + 2) | (uint16_t)hal_eeprom_read(a + 3) << 8;
+		if (found && (int16_t)(s - seq) <= 0)
+			continue;	/* older than the best so far */
+		for (j = 0; j < PARAMS_SLOT; j++)
+			b[j] = hal_eeprom_read(a + j);
+		if (get16(b + BODY) != crc16(b, BODY))
+			continue;
+		p->target = get16(b + 4);
+		p->kP = get32(b + 6);
+		p->kI = get32(b + 10);
+		p->kD = get32(b + 14);
+		seq = s;
+		slot = i;
+		found = 1;
+	}
+	return found;
+}
+
+void params_save(const params *p)
+{
+	next = *p;
+	pending = 1;
+}
+
+void params_poll(void)
+{
+	uint16_t a;
+
+	if (hal_eeprom_busy())
+		return;
+	if (pos == PARAMS_SLOT) {
+		if (!pending)
+			return;
+		pending = 0;
+		slot = slot + 1 == PARAMS_SLOTS ? 0 : slot + 1;
+		pack(image, &next, ++seq);
+		pos = 0;
+	}
+	for (; pos < PARAMS_SLOT; pos++) {
+		a = slot*PARAMS_SLOT + pos;
+		if (hal_eeprom_read(a) != image[pos]) {
+			hal_eeprom_write(a, image[pos++]);
+			return;
+		}
+	}
+}
+
+uint8_t params_busy(void)
+{
+	return pending || pos < PARAMS_SLOT;
+}
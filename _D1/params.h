@@ -0,0 +1,43 @@
+#ifndef PARAMS_H
+#define PARAMS_H
+
+#include <stdint.h>
+#include "hal.h"
+
+/* Controller settings kept in EEPROM across resets.
+ *
+ * The EEPROM is a ring of PARAMS_SLOTS slots of PARAMS_SLOT bytes, little
+ * endian:
+ *   0  uint8  magic     PARAMS_MAGIC
+ *   1  uint8  version   PARAMS_VERSION, bumped when the layout changes
+ *   2  uint16 seq       one more than the save before, wrapping
+ *   4  int16  target    Q5.10 volts
+ *   6  int32  kP, kI, kD  millionths
+ *   18 uint16 crc       CRC-16 (poly 0xA001, from 0xFFFF) of bytes 0-17
+ * Each save goes to the slot after the newest, so the writes are spread
+ * over the whole EEPROM and the newest good block is never overwritten: a
+ * save cut short by a reset fails its CRC and the one before is loaded.
+ *
+ * params_load() scans the ring at start up, a few ms before sei().
+ * params_save() only queues the block; params_poll(), a main loop task,
+ * starts one byte write each time the EEPROM is idle and skips bytes that
+ * already match, so a save takes at most PARAMS_SLOT*3.4 ms and nothing
+ * waits for it. A save made while one is in progress follows it.
+ */
+
+#define PARAMS_MAGIC	0xB5
+#define PARAMS_VERSION	1
+#define PARAMS_SLOT	20
+#define PARAMS_SLOTS	(HAL_EEPROM_SIZE/PARAMS_SLOT)
+
+typedef struct {
+	int16_t target;
+	int32_t kP, kI, kD;
+} params;
+
+uint8_t params_load(params *p);
+void params_save(const params *p);
+void params_poll(void);
+uint8_t params_busy(void);
+
+#endif
@@ -0,0 +1,100 @@
+#include <math.h>
+#include "pid.h"
+
+static int16_t sat16(int32_t x)
+{
+	if (x > INT16_MAX) return INT16_MAX;
+	if (x < INT16_MIN) return INT16_MIN;
+	return x;
+}
+
+static int32_t sat_add32(int32_t a, int32_t b)
+{
+	int32_t r = (int32_t)((uint32_t)a + (uint32_t)b);
+	/* Overflow only when both operands share a sign the result lacks */
+	if (((a ^ r) & (b ^ r)) < 0)
+		return (a < 0) ? INT32_MIN : INT32_MAX;
+	return r;
+}
+
+/* Choose m and s so that (x*m) >> s == g*x in Q24 duty, for x in Qqx */
+static pid_gain make_gain(double g, uint8_t qx)
+{
+	pid_gain k = {0, 0};
+	double v = fabs(g) * ldexp(1.0, PID_DBITS - qx);
+	if (v == 0.0) return k;
+	while (v < 16384.0 && k.s < 30) {
+		v *= 2.0;
+		k.s++;
+	}
+	k.m = (v > INT16_MAX) ? INT16_MAX : (int16_t)(v + 0.5);
+	if (g < 0) k.m = -k.m;
+	return k;
+}
+
+static int32_t gain_mul(pid_gain k, int16_t x)
+{
+	return ((int32_t)x * k.m) >> k.s;
+}
+
+void pid_init(pid *p, double dt, double duty, double duty_min, double duty_max)
+{
+	p->dt = (uint16_t)(dt*65536.0 + 0.5);
+	p->target = 0;
+	p->error = p->error_old = p->error_dif = p->error_int = 0;
+	p->duty = p->duty_reset = PID_DUTY(duty);
+	p->duty_min = PID_DUTY(duty_min);
+	p->duty_max = PID_DUTY(duty_max);
+	p->kP = p->kI = p->kD = make_gain(0.0, 0);
+}
+
+void pid_set_gains(pid *p, double kP, double kI, double kD)
+{
+	p->kP = make_gain(kP, PID_VBITS);
+	p->kI = make_gain(kI, 15);
+	p->kD = make_gain(kD * 65536.0 / p->dt, PID_VBITS);
+}
+
+/* Same law as the original double version:
+ *   error     = v - target
+ *   error_dif = (error - error_old)/dt
+ *   error_int = (error_int + error)*dt
+ *   duty     -= error*kP + error_int*kI + error_dif*kD
+ * with the duty snapped back to duty_reset when it leaves its limits.
+ */
+void pid_update(pid *p, int16_t v)
+{
+	int32_t sum, term;
+
+	p->error = sat16((int32_t)v - p->target);
+	p->error_dif = sat16((int32_t)p->error - p->error_old);
+
+	/* Q15 integral; clamping the sum to 2^20 keeps sum*dt inside 32 bits */
+	sum = (int32_t)p->error_int + ((int32_t)p->error << (15 - PID_VBITS));
+	if (sum > (1L<<20)) sum = 1L<<20;
+	if (sum < -(1L<<20)) sum = -(1L<<20);
+	p->error_int = sat16((sum * p->dt) >> 16);
+
+	term = gain_mul(p->kP, p->error);
+	term = sat_add32(term, gain_mul(p->kI, p->error_int));
+	term = sat_add32(term, gain_mul(p->kD, p->error_dif));
+	p->duty = sat_add32(p->duty, (term == INT32_MIN) ? INT32_MAX : -term);
+
+	if (p->duty > p->duty_max || p->duty < p->duty_min)
+		p->duty = p->duty_reset;
+	p->error_old = p->error;
+}
+
+/* Duty as an OCR compare value scaled to pwm_max */
+uint8_t pid_pwm(const pid *p, uint8_t pwm_max)
+{
+	if (p->duty <= 0) return 0;
+	return (uint8_t)(((uint32_t)(p->duty >> 8) * pwm_max) >> 16);
+}
+
+/* Same with 8 fractional bits, for hal_pwm_write16() */
+uint16_t pid_pwm16(const pid *p, uint8_t pwm_max)
+{
+	if (p->duty <= 0) return 0;
+	return (uint16_t)(((uint32_t)(p->duty >> 8) * pwm_max) >> 8);
+}
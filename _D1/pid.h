@@ -0,0 +1,56 @@
+#ifndef PID_H
+#define PID_H
+
+#include <stdint.h>
+
+/* Fixed-point PID engine for the boost converter.
+ *
+ * Voltages and errors are Q5.10 volts (int16_t), the integral is Q0.15
+ * volts times dt and the duty cycle is Q8.24 (int32_t). Gains are converted
+ * once by pid_set_gains() into a 16-bit mantissa and a right shift, with dt
+ * folded into kD, so pid_update() is three 16x16 multiplies and no floats.
+ *
+ * dt is the step the gains are scaled for. It need not be the real call
+ * period: boost.c calls pid_update() at 1 kHz with dt 0.01, kept from its
+ * old 100 Hz tick, so kI and kD are per-step constants there and its gains
+ * are tuned for the 1 kHz step rather than carried over from 100 Hz.
+ */
+
+#define PID_VREF	3.3	/* ADC reference voltage */
+#define PID_ADCMAX	1023	/* 10 bit ADC */
+#define PID_VDIV	0.176	/* Vout divider onto PA0 */
+
+#define PID_VBITS	10
+#define PID_DBITS	24
+
+#define PID_V(v)	((int16_t)((v)*(1<<PID_VBITS) + ((v) < 0 ? -0.5 : 0.5)))
+#define PID_VI(v)	((int16_t)((int16_t)(v) << PID_VBITS))
+#define PID_DUTY(d)	((int32_t)((d)*(1L<<PID_DBITS) + 0.5))
+
+/* ADC counts at PA0 to Q10 volts at the load, evaluated at compile time */
+#define PID_ADC2V_K	((uint16_t)(PID_VREF/PID_ADCMAX/PID_VDIV*(1L<<(PID_VBITS+8)) + 0.5))
+#define PID_ADC_TO_V(adc)	((int16_t)(((uint32_t)(adc)*PID_ADC2V_K) >> 8))
+/* Same for an oversampled reading carrying xbits extra bits */
+#define PID_ADCX_TO_V(adc, xbits)	((int16_t)(((uint32_t)(adc)*PID_ADC2V_K) >> (8 + (xbits))))
+
+typedef struct {
+	int16_t m;	/* mantissa */
+	uint8_t s;	/* right shift applied to x*m */
+} pid_gain;
+
+typedef struct {
+	pid_gain kP, kI, kD;	/* kD is pre-divided by dt */
+	uint16_t dt;		/* Q16, must be below 1/32; see pid_init() */
+	int16_t target;		/* Q10 volts */
+	int16_t error, error_old, error_dif;	/* Q10 volts */
+	int16_t error_int;	/* Q15 volt-seconds */
+	int32_t duty, duty_min, duty_max, duty_reset;	/* Q24 */
+} pid;
+
+void pid_init(pid *p, double dt, double duty, double duty_min, double duty_max);
+void pid_set_gains(pid *p, double kP, double kI, double kD);
+void pid_update(pid *p, int16_t v);
+uint8_t pid_pwm(const pid *p, uint8_t pwm_max);
+uint16_t pid_pwm16(const pid *p, uint8_t pwm_max);
+
+#endif
@@ -0,0 +1,105 @@
+/*   pid_bench.c
+ *
+ *   Cycle count of one controller step, original double law against
+ *   the fixed-point pid_update(). Timer1 runs without a prescaler so
+ *   TCNT1 counts CPU cycles directly. Results are printed over UART0.
+ *
+ *   avr-gcc -mmcu=atmega644p -DF_CPU=12000000 -Wall -Os -c pid_bench.c -o pid_bench.o
+ *   avr-gcc -mmcu=atmega644p -L. -o pid_bench.elf pid_bench.o -llcd -lm
+ */
+
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "pid.h"
+
+#define BDRATE_BAUD  9600
+#define RUNS         64
+
+volatile double error, error_int, error_dif, error_old = 0;
+volatile double DutyCycle = 0.3;
+volatile double kP = 0.0015;
+volatile double kI = 0.00025;
+volatile double kD = 0.0005;
+volatile uint8_t Vout_target = 10;
+volatile uint16_t adc_sample;
+
+pid ctrl;
+
+int uputchar0(char c, FILE *stream)
+{
+	if (c == '\n') uputchar0('\r', stream);
+	while (!(UCSR0A & _BV(UDRE0)));
+	UDR0 = c;
+	return c;
+}
+
+void init_stdio2uart0(void)
+{
+	UBRR0H = (F_CPU/(BDRATE_BAUD*16L)-1) >> 8;
+	UBRR0L = (F_CPU/(BDRATE_BAUD*16L)-1);
+	UCSR0B = _BV(TXEN0);
+	UCSR0C = _BV(UCSZ00) | _BV(UCSZ01);
+
+	static FILE uout = FDEV_SETUP_STREAM(uputchar0, NULL, _FDEV_SETUP_WRITE);
+	stdout = &uout;
+}
+
+/* Body of the old TIMER1_COMPA_vect in boost.c */
+void double_step(void)
+{
+	error = ((adc_sample * 3.3/1023)/0.176 - Vout_target);
+	error_dif = ((error - error_old)/0.01);
+	error_int = ((error_int + error) * 0.01);
+	DutyCycle = DutyCycle-(error*kP + error_int*kI + error_dif*kD);
+	if (DutyCycle > 0.95 || DutyCycle < 0.1){
+		DutyCycle = 0.3;
+	}
+	OCR2A = (int16_t)(DutyCycle*240);
+	error_old = error;
+}
+
+void fixed_step(void)
+{
+	ctrl.target = PID_VI(Vout_target);
+	pid_update(&ctrl, PID_ADC_TO_V(adc_sample));
+	OCR2A = pid_pwm(&ctrl, 240);
+}
+
+uint16_t time_step(void (*step)(void), uint16_t *worst)
+{
+	uint32_t total = 0;
+	uint16_t i, t0, t;
+	*worst = 0;
+	for (i = 0; i < RUNS; i++) {
+		adc_sample = 450 + (i*37) % 200;	/* sweep around the 10V set point */
+		cli();
+		t0 = TCNT1;
+		step();
+		t = TCNT1 - t0;
+		sei();
+		total += t;
+		if (t > *worst) *worst = t;
+	}
+	return total / RUNS;
+}
+
+int main(void)
+{
+	uint16_t avg, worst;
+
+	init_stdio2uart0();
+	pid_init(&ctrl, 0.01, 0.3, 0.1, 0.95); //boost.c PID_DT
+	pid_set_gains(&ctrl, kP, kI, kD);
+
+	TCCR1A = 0;
+	TCCR1B = _BV(CS10);	/* clk/1 */
+
+	for (;;) {
+		avg = time_step(double_step, &worst);
+		printf("double: avg %5u worst %5u cycles\n", avg, worst);
+		avg = time_step(fixed_step, &worst);
+		printf("fixed:  avg %5u worst %5u cycles\n\n", avg, worst);
+	}
+}
@@ -0,0 +1,217 @@
+#include <math.h>
+#include "plant.h"
+#include "pid.h"
+
+void plant_init(plant *p)
+{
+	p->vin = 5.0;
+	p->l = 100e-6;
+	p->rl = 0.1;
+	p->c = 100e-6;
+	p->esr = 0.05;
+	p->r = 100.0;
+	p->vd = 0.3;
+	p->fsw = F_CPU/256.0;	/* Timer2 fast PWM, no prescaling */
+	p->h = 1.0/p->fsw;	/* one PWM period */
+	p->exact = 0;
+
+	p->il = 0.0;
+	p->vc = p->vin - p->vd;	/* output charges through the diode at power up */
+	p->vout = p->vc;
+	p->dcm = 0;
+	p->t_left = 0.0;
+}
+
+/* Per-run constants, so the RK4 stages avoid most divisions */
+typedef struct {
+	double vin, vd, rl, esr;
+	double inv_l, inv_c, inv_r;
+	double kout;	/* r/(r + esr) */
+	double kdcm;	/* vin/(2 l fsw) */
+} coef;
+
+static void make_coef(const plant *p, coef *k)
+{
+	k->vin = p->vin;
+	k->vd = p->vd;
+	k->rl = p->rl;
+	k->esr = p->esr;
+	k->inv_l = 1.0/p->l;
+	k->inv_c = 1.0/p->c;
+	k->inv_r = 1.0/p->r;
+	k->kout = p->r/(p->r + p->esr);
+	k->kdcm = p->vin/(2.0*p->l*p->fsw);
+}
+
+/* Mean inductor current of a discontinuous period at output vo, from the
+ * volt-second balance d*vin = d2*(vo + vd - vin). Returns -1 when the
+ * inductor would not run dry, i.e. the converter is in CCM.
+ */
+static double dcm_current(const coef *k, double vo, double d, double *d2)
+{
+	if (d <= 0.0 || vo + k->vd <= k->vin)
+		return -1.0;
+	*d2 = d*k->vin/(vo + k->vd - k->vin);
+	if (d + *d2 >= 1.0)
+		return -1.0;
+	return k->kdcm*d*(d + *d2);
+}
+
+static double output(const coef *k, double vc, double id)
+{
+	return (vc + k->esr*id)*k->kout;
+}
+
+static void ccm_deriv(const coef *k, double il, double vc, double d,
+		      double *dil, double *dvc)
+{
+	double id, vo;
+
+	if (il < 0.0) il = 0.0;
+	id = (1.0 - d)*il;
+	vo = output(k, vc, id);
+	*dil = (k->vin - k->rl*il - (1.0 - d)*(vo + k->vd))*k->inv_l;
+	*dvc = (id - vo*k->inv_r)*k->inv_c;
+}
+
+/* In DCM the inductor current is algebraic; only vc is integrated */
+static double dcm_deriv(const coef *k, double vc, double d)
+{
+	double d2, id, il = dcm_current(k, vc, d, &d2);
+	id = (il < 0.0) ? 0.0 : il*d2/(d + d2);
+	return (id - output(k, vc, id)*k->inv_r)*k->inv_c;
+}
+
+/* CCM at duty d is x' = A x + b with x = (il, vc), m = 1 - d:
+ *   A = | -(rl + m^2 esr kout)/l   -m kout/l    |   b = | (vin - m vd)/l |
+ *       |  m kout/c                -kout/(r c)  |       |  0             |
+ * so x(t) = x* + e^(A t)(x - x*), x* = -A^-1 b, with e^(A t) from the
+ * eigenvalues s +- mu of the 2x2 A.
+ */
+static void ccm_exact(plant *p, const coef *k, double d)
+{
+	double m = 1.0 - d, h = p->h;
+	double a11 = -(k->rl + m*m*k->esr*k->kout)*k->inv_l, a12 = -m*k->kout*k->inv_l;
+	double a21 = m*k->kout*k->inv_c, a22 = -k->kout*k->inv_r*k->inv_c;
+	double b1 = (k->vin - m*k->vd)*k->inv_l;
+	double det = a11*a22 - a12*a21;
+	double il0 = -a22*b1/det, vc0 = a21*b1/det;	/* x* */
+	double s = (a11 + a22)/2, q = (a11 - a22)*(a11 - a22)/4 + a12*a21;
+	double ch, sh, e, x1 = p->il - il0, x2 = p->vc - vc0;
+
+	if (q > 0.0) {
+		double mu = sqrt(q);
+		ch = cosh(mu*h);
+		sh = sinh(mu*h)/mu;
+	} else if (q < 0.0) {
+		double w = sqrt(-q);
+		ch = cos(w*h);
+		sh = sin(w*h)/w;
+	} else {
+		ch = 1.0;
+		sh = h;
+	}
+	e = exp(s*h);
+	/* e^(A h) = e^(s h) (ch I + sh (A - s I)) */
+	p->il = il0 + e*((ch + sh*(a11 - s))*x1 + sh*a12*x2);
+	p->vc = vc0 + e*(sh*a21*x1 + (ch + sh*(a22 - s))*x2);
+	p->vout = output(k, p->vc, m*p->il);
+}
+
+static void ccm_leap(plant *p, const coef *k, double d);
+
+static void rk4(plant *p, const coef *k, double d)
+{
+	double h = p->h, d2, ild;
+	double k1i, k1v, k2i, k2v, k3i, k3v, k4i, k4v;
+
+	ild = dcm_current(k, p->vc, d, &d2);
+	p->dcm = ild >= 0.0 && p->il <= ild;
+	if (p->dcm) {
+		k1v = dcm_deriv(k, p->vc, d);
+		k2v = dcm_deriv(k, p->vc + h/2*k1v, d);
+		k3v = dcm_deriv(k, p->vc + h/2*k2v, d);
+		k4v = dcm_deriv(k, p->vc + h*k3v, d);
+		p->vc += h/6*(k1v + 2*k2v + 2*k3v + k4v);
+		ild = dcm_current(k, p->vc, d, &d2);
+		p->il = (ild < 0.0) ? p->il : ild;
+		p->vout = output(k, p->vc, (ild < 0.0) ? 0.0 : ild*d2/(d + d2));
+		return;
+	}
+	if (p->exact) {
+		ccm_leap(p, k, d);
+		return;
+	}
+
+	ccm_deriv(k, p->il, p->vc, d, &k1i, &k1v);
+	ccm_deriv(k, p->il + h/2*k1i, p->vc + h/2*k1v, d, &k2i, &k2v);
+	ccm_deriv(k, p->il + h/2*k2i, p->vc + h/2*k2v, d, &k3i, &k3v);
+	ccm_deriv(k, p->il + h*k3i, p->vc + h*k3v, d, &k4i, &k4v);
+	p->il += h/6*(k1i + 2*k2i + 2*k3i + k4i);
+	p->vc += h/6*(k1v + 2*k2v + 2*k3v + k4v);
+	if (p->il < 0.0) p->il = 0.0;
+	p->vout = output(k, p->vc, (1.0 - d)*p->il);
+}
+
+/* A step of h with the exact solution, unless the inductor runs dry on the
+ * way: the model leaves CCM there, so the step is redone a PWM period at a
+ * time as it is without exact.
+ */
+static void ccm_leap(plant *p, const coef *k, double d)
+{
+	plant start = *p;
+	double h = p->h, d2, ild;
+	int i, n;
+
+	ccm_exact(p, k, d);
+	ild = dcm_current(k, p->vc, d, &d2);
+	if (p->il > 0.0 && !(ild >= 0.0 && p->il <= ild))
+		return;
+	*p = start;
+	n = (int)ceil(h*p->fsw - 1e-6);
+	p->exact = 0;
+	p->h = h/n;
+	for (i = 0; i < n; i++)
+		rk4(p, k, d);
+	p->exact = 1;
+	p->h = h;
+}
+
+/* Advance t seconds at duty d, in whole steps of h */
+void plant_run(plant *p, double d, double t)
+{
+	coef k;
+	make_coef(p, &k);
+	p->t_left += t;
+	while (p->t_left >= p->h) {
+		rk4(p, &k, d);
+		p->t_left -= p->h;
+	}
+}
+
+/* OCR2A to duty in non-inverting fast PWM; 0 still gives a one count
+ * spike on the pin, which is ignored here.
+ */
+double plant_duty(uint8_t ocr)
+{
+	return ocr ? (ocr + 1)/256.0 : 0.0;
+}
+
+/* Mean duty of an 8.8 OCR2A value dithered over many periods, which the
+ * averaged model cannot tell from a steady one
+ */
+double plant_duty16(uint16_t ocr)
+{
+	return ocr ? (ocr/256.0 + 1)/256.0 : 0.0;
+}
+
+/* Output voltage as the ADC sees it through the PA0 divider, with xbits
+ * extra bits of oversampled resolution.
+ */
+uint16_t plant_adc(const plant *p, uint8_t xbits)
+{
+	double counts = p->vout*PID_VDIV/PID_VREF*PID_ADCMAX*(1 << xbits);
+	if (counts <= 0.0) return 0;
+	if (counts >= (double)((uint32_t)PID_ADCMAX << xbits)) return PID_ADCMAX << xbits;
+	return (uint16_t)counts;
+}
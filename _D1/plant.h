@@ -0,0 +1,42 @@
+#ifndef PLANT_H
+#define PLANT_H
+
+#include <stdint.h>
+
+/* Averaged state-space model of the boost converter, for host builds.
+ *
+ * States are the inductor current il and the output capacitor voltage vc.
+ * The switch is averaged over a PWM period. When the inductor runs dry
+ * each period (discontinuous conduction) il becomes algebraic, set by the
+ * volt-second balance, and only vc is integrated; this keeps the model
+ * stable at a step of one PWM period. plant_run() integrates with fixed
+ * RK4 steps of h seconds.
+ *
+ * With exact set, CCM steps use the exact solution of the model instead,
+ * which is linear at a fixed duty, so they are stable at any h and h can
+ * span several PWM periods. The mode is still checked once per step.
+ */
+
+typedef struct {
+	double vin;	/* input voltage */
+	double l, rl;	/* inductance and its series resistance */
+	double c, esr;	/* output capacitance and its ESR */
+	double r;	/* load resistance */
+	double vd;	/* diode forward drop */
+	double fsw;	/* PWM frequency */
+	double h;	/* integration step */
+	uint8_t exact;	/* CCM steps solved exactly rather than by RK4 */
+
+	double il, vc;	/* state */
+	double vout;	/* output voltage including ESR drop */
+	uint8_t dcm;	/* last step was discontinuous */
+	double t_left;	/* part of a step carried over between calls */
+} plant;
+
+void plant_init(plant *p);
+void plant_run(plant *p, double d, double t);
+double plant_duty(uint8_t ocr);
+double plant_duty16(uint16_t ocr);
+uint16_t plant_adc(const plant *p, uint8_t xbits);
+
+#endif
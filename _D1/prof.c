@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "hal.h"
+#include "fmt.h"
+#include "prof.h"
+
+static volatile uint16_t lat[PROF_BINS], dur[PROF_BINS];
+static volatile uint16_t lat_max, dur_max, runs, overruns;
+static volatile uint16_t entry;
+static volatile uint8_t active;
+static uint16_t top;
+
+static void count(volatile uint16_t *h, uint16_t x, uint8_t shift)
+{
+	x >>= shift;
+	if (x >= PROF_BINS) x = PROF_BINS - 1;
+	if (h[x] != UINT16_MAX) h[x]++;
+}
+
+static void overrun(void)
+{
+	if (overruns != UINT16_MAX) overruns++;
+}
+
+/* First thing in the ISR */
+void prof_enter(void)
+{
+	uint16_t p = hal_tick_phase();
+	if (active)
+		overrun();
+	active = 1;
+	entry = p;
+	count(lat, p, PROF_LAT_SHIFT);
+	if (p > lat_max) lat_max = p;
+	if (runs != UINT16_MAX) runs++;
+}
+
+/* Last thing in the ISR */
+void prof_exit(void)
+{
+	uint16_t p = hal_tick_phase(), d = p - entry;
+	if (p > top)
+		overrun();
+	count(dur, d, PROF_DUR_SHIFT);
+	if (d > dur_max) dur_max = d;
+	active = 0;
+}
+
+/* top as given to hal_tick_init() */
+void prof_init(uint16_t t)
+{
+	top = t;
+	prof_clear();
+}
+
+void prof_clear(void)
+{
+	uint8_t i;
+	cli();
+	for (i = 0; i < PROF_BINS; i++)
+		lat[i] = dur[i] = 0;
+	lat_max = dur_max = runs = overruns = 0;
+	sei();
+}
+
+/* Timer1 counts as microseconds, one decimal */
+static char *us(char *s, uint32_t counts)
+{
+	fmt_dec(s, (counts*HAL_TICK_DIV*10 + F_CPU/2000000)/(F_CPU/1000000), 1, 7);
+	return s;
+}
+
+void prof_report(void)
+{
+	char a[FMT_BUF], b[FMT_BUF];
+	uint16_t l[PROF_BINS], d[PROF_BINS], n, o, lm, dm;
+	uint8_t i;
+
+	/* one consistent copy, printed with interrupts on */
+	cli();
+	for (i = 0; i < PROF_BINS; i++) {
+		l[i] = lat[i];
+		d[i] = dur[i];
+	}
+	n = runs;
+	o = overruns;
+	lm = lat_max;
+	dm = dur_max;
+	sei();
+
+	printf("tick isr: %u runs, %u overruns, max latency %s us, max duration %s us\n",
+		n, o, us(a, lm), us(b, dm));
+	printf("  from us  latency     from us duration\n");
+	for (i = 0; i < PROF_BINS; i++) {
+		us(a, (uint32_t)i << PROF_LAT_SHIFT);
+		us(b, (uint32_t)i << PROF_DUR_SHIFT);
+		printf("%s%c %7u     %s%c %7u\n", a, i == PROF_BINS - 1 ? '+' : ' ', l[i],
+			b, i == PROF_BINS - 1 ? '+' : ' ', d[i]);
+	}
+}
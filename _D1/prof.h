@@ -0,0 +1,36 @@
+#ifndef PROF_H
+#define PROF_H
+
+#include <stdint.h>
+
+/* Latency and duration profile of the Timer1 tick ISR. With CTRL_SYNC in
+ * boost.c the controller runs in ADC_vect instead and is not covered.
+ *
+ * Timer1 restarts from 0 at each compare match, so hal_tick_phase() at
+ * the top of the ISR is its entry latency, and the difference between
+ * entries is the tick period plus the change in latency: the histogram of
+ * latency is the period jitter. prof_enter() and prof_exit() bracket the
+ * ISR body; both histograms have PROF_BINS bins, the last one holding
+ * everything above. An overrun is a run that ends after the next compare
+ * match, or starts while the previous run is still going (TIMER1_COMPA_vect
+ * is ISR_NOBLOCK, so it can nest). Counts stop at 65535.
+ *
+ * prof_report() prints it all over the UART, in microseconds. In host
+ * builds simulated time stands still inside an ISR, so every run reads 0.
+ */
+
+#define PROF_BINS	16
+#ifndef PROF_LAT_SHIFT
+#define PROF_LAT_SHIFT	0	/* latency bin width, 2^n Timer1 counts */
+#endif
+#ifndef PROF_DUR_SHIFT
+#define PROF_DUR_SHIFT	4	/* duration bin width */
+#endif
+
+void prof_init(uint16_t top);
+void prof_enter(void);
+void prof_exit(void);
+void prof_clear(void);
+void prof_report(void);
+
+#endif
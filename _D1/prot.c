@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <avr/interrupt.h>
+#include "prot.h"
+#include "hal.h"
+
+static const char *const state_name[] = {"run", "hold", "soft start", "locked out"};
+
+static prot_policy policy;
+static volatile prot_state state;
+static volatile uint8_t fault, soft;
+static uint8_t used;		/* restarts since the last clean stretch */
+static uint16_t left;		/* ticks left in the hold */
+static uint16_t clean;		/* ticks since the last trip */
+static volatile uint16_t ceiling;	/* soft start duty limit, 8.8 */
+static uint16_t rise;
+static volatile uint16_t trips;
+
+void prot_init(const prot_policy *p, uint16_t limit)
+{
+	policy = *p;
+	if (policy.ramp == 0) policy.ramp = 1;
+	rise = 0xFFFF/policy.ramp;
+	state = PROT_RUN;
+	ceiling = 0xFFFF;
+	hal_ovp_init(limit);
+}
+
+static void tripped(void)
+{
+	fault = soft ? PROT_SOFTWARE : PROT_OVERVOLT;
+	soft = 0;
+	if (trips < 0xFFFF) trips++;
+	clean = 0;
+	ceiling = 0;
+	if (used >= policy.retries) {
+		state = PROT_LOCKOUT;
+		return;
+	}
+	used++;
+	left = policy.holdoff;
+	state = PROT_HOLD;
+}
+
+void prot_tick(void)
+{
+	switch (state) {
+	case PROT_RUN:
+	case PROT_SOFT:
+		if (hal_ovp_tripped()) {
+			tripped();
+			break;
+		}
+		if (clean < policy.forgive && ++clean == policy.forgive)
+			used = 0;
+		if (state == PROT_SOFT) {
+			if (ceiling > 0xFFFF - rise) {
+				ceiling = 0xFFFF;
+				state = PROT_RUN;
+			} else
+				ceiling += rise;
+		}
+		break;
+	case PROT_HOLD:
+		if (left && --left)
+			break;
+		if (hal_ovp_arm())
+			state = PROT_SOFT;
+		else
+			left = policy.holdoff;	/* still over, hold again */
+		break;
+	case PROT_LOCKOUT:
+		break;
+	}
+}
+
+/* Cuts the PWM as the trip would, for faults found in software */
+void prot_trip(void)
+{
+	soft = 1;
+	hal_ovp_trip();
+}
+
+/* duty, 8.8, under the soft start ceiling; 0 while held or locked out */
+uint16_t prot_limit(uint16_t duty)
+{
+	uint16_t c = ceiling;
+	return duty < c ? duty : c;
+}
+
+uint8_t prot_running(void)
+{
+	return state == PROT_RUN || state == PROT_SOFT;
+}
+
+prot_state prot_status(void)
+{
+	return state;
+}
+
+/* Code of the latest fault since prot_clear() */
+uint8_t prot_fault(void)
+{
+	return fault;
+}
+
+/* Forgets the fault, and restarts through the hold if locked out */
+void prot_clear(void)
+{
+	cli();
+	fault = PROT_NONE;
+	used = 0;
+	if (state == PROT_LOCKOUT) {
+		left = policy.holdoff;
+		state = PROT_HOLD;
+	}
+	sei();
+}
+
+void prot_report(void)
+{
+	uint8_t f = fault;
+	printf("protection: %s, fault %u (%s), %u trips\n", state_name[state], f,
+		f == PROT_OVERVOLT ? "overvoltage" : f == PROT_SOFTWARE ? "software" : "none",
+		trips);
+}
@@ -0,0 +1,48 @@
+#ifndef PROT_H
+#define PROT_H
+
+#include <stdint.h>
+#include "pid.h"
+
+/* Overvoltage protection and restart policy.
+ *
+ * The PWM is cut in interrupt context by the hal_ovp_*() trip (hal.h), so
+ * how quickly it reacts has nothing to do with the control loop. This
+ * module only decides when to let it run again. prot_tick(), called from
+ * the tick ISR, sees the trip, latches its fault code, and holds the
+ * output off for holdoff ticks. It then re-arms the trip and lets the duty
+ * ceiling prot_limit() rise from 0 to full over ramp ticks, a soft start.
+ * If Vout is still over after the hold, the hold starts again. More than
+ * retries trips without forgive clean ticks in between lock the output off
+ * until prot_clear(). The control loop should keep its duty at the bottom
+ * while prot_running() is 0, so it does not restart wound up.
+ */
+
+/* Fault codes, prot_fault() */
+#define PROT_NONE	0
+#define PROT_OVERVOLT	1	/* the hardware trip */
+#define PROT_SOFTWARE	2	/* prot_trip() */
+
+typedef enum {PROT_RUN, PROT_HOLD, PROT_SOFT, PROT_LOCKOUT} prot_state;
+
+typedef struct {
+	uint16_t holdoff;	/* ticks off after a trip */
+	uint16_t ramp;		/* ticks of soft start, at least 1 */
+	uint8_t retries;	/* restarts before locking out, 0 latches at once */
+	uint16_t forgive;	/* clean ticks that reset the retry count */
+} prot_policy;
+
+/* Raw 10-bit ADC counts at Vout volts, through the PA0 divider */
+#define PROT_ADC(v)	((uint16_t)((v)*PID_VDIV/PID_VREF*PID_ADCMAX + 0.5))
+
+void prot_init(const prot_policy *p, uint16_t limit);
+void prot_tick(void);
+void prot_trip(void);
+uint16_t prot_limit(uint16_t duty);
+uint8_t prot_running(void);
+prot_state prot_status(void);
+uint8_t prot_fault(void);
+void prot_clear(void);
+void prot_report(void);
+
+#endif
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "hal.h"
+#include "sched.h"
+
+static sched_task tasks[SCHED_MAX];
+static uint8_t ntasks;
+static volatile uint32_t ticks;
+static uint16_t period;		/* Timer1 counts per tick */
+static volatile uint16_t isr_max;
+
+/* Starts the tick; the caller's TIMER1_COMPA_vect must call sched_tick() */
+void sched_init(uint16_t top)
+{
+	period = top + 1;
+	hal_tick_init(top);
+}
+
+/* Returns 0 when the table is full. The first release of a periodic task
+ * is one period after start up.
+ */
+sched_task *sched_add(const char *name, sched_fn run, uint16_t period, uint8_t prio)
+{
+	sched_task *t;
+	if (ntasks == SCHED_MAX)
+		return 0;
+	t = &tasks[ntasks++];
+	t->name = name;
+	t->run = run;
+	t->period = t->left = period;
+	t->prio = prio;
+	t->ready = 0;
+	t->runs = t->overruns = 0;
+	t->wcet = 0;
+	return t;
+}
+
+/* Interrupt context */
+void sched_tick(void)
+{
+	uint16_t p = hal_tick_phase();
+	uint8_t i;
+	sched_task *t;
+
+	if (p > isr_max) isr_max = p;
+	ticks++;
+	for (i = 0, t = tasks; i < ntasks; i++, t++) {
+		if (!t->period || --t->left)
+			continue;
+		t->left = t->period;
+		if (t->ready && t->overruns != UINT16_MAX)
+			t->overruns++;
+		t->ready = 1;
+	}
+}
+
+/* Interrupt context. Posts before the task runs fold into one run. */
+void sched_post(sched_task *t)
+{
+	t->ready = 1;
+}
+
+/* Next release in period ticks and every period after; 0 stops releases */
+void sched_period(sched_task *t, uint16_t period)
+{
+	cli();
+	t->period = t->left = period;
+	sei();
+}
+
+static sched_task *next_ready(void)
+{
+	sched_task *t, *best = 0;
+	uint8_t i;
+	for (i = 0, t = tasks; i < ntasks; i++, t++)
+		if (t->ready && (!best || t->prio < best->prio))
+			best = t;
+	return best;
+}
+
+void sched_run(void)
+{
+	sched_task *t;
+	uint32_t start, d;
+
+	while ((t = next_ready())) {
+		cli();
+		t->ready = 0;
+		sei();
+		start = sched_clock();
+		t->run();
+		d = sched_clock() - start;
+		if (d > t->wcet) t->wcet = d;
+		if (t->period && d > (uint32_t)t->period*period && t->overruns != UINT16_MAX)
+			t->overruns++;
+		t->runs++;
+	}
+}
+
+/* HAL_TICK_CLOCK counts since sched_init(), from the main loop */
+uint32_t sched_clock(void)
+{
+	uint32_t t;
+	uint16_t p;
+	cli();
+	t = ticks;
+	p = hal_tick_phase();
+	sei();
+	return t*period + p;
+}
+
+uint32_t sched_ticks(void)
+{
+	uint32_t t;
+	cli();
+	t = ticks;
+	sei();
+	return t;
+}
+
+static uint32_t to_us(uint32_t counts)
+{
+	return counts*HAL_TICK_DIV/(F_CPU/1000000);
+}
+
+void sched_report(void)
+{
+	sched_task *t;
+	uint8_t i;
+	printf("task      period   runs  wcet_us  overruns\n");
+	for (i = 0, t = tasks; i < ntasks; i++, t++)
+		printf("%-8s %7u %6u %8lu %9u\n", t->name, t->period, t->runs,
+			(unsigned long)to_us(t->wcet), t->overruns);
+	printf("tick isr %7u          %8lu\n", 1, (unsigned long)to_us(isr_max));
+}
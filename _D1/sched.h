@@ -0,0 +1,45 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+
+/* Cooperative multi-rate scheduler for the main loop.
+ *
+ * sched_tick() is called from the Timer1 tick ISR, which also runs the
+ * control loop itself, so nothing here can delay it. Each tick releases
+ * the periodic tasks that are due; sched_post() releases an event task
+ * from any ISR. sched_run() runs ready tasks to completion, highest
+ * priority (lowest prio) first, until none is left.
+ *
+ * Every run is timed with sched_clock(). A periodic task counts an overrun
+ * when it is released again before it has started, or when one run takes
+ * longer than its period. sched_report() prints the table, together with the
+ * latest the tick ISR has reached sched_tick() after its compare match.
+ */
+
+#define SCHED_MAX	8
+
+typedef void (*sched_fn)(void);
+
+typedef struct {
+	const char *name;
+	sched_fn run;
+	uint16_t period;	/* ticks between releases, 0 for events only */
+	uint16_t left;		/* ticks to the next release */
+	uint8_t prio;		/* 0 runs first */
+	volatile uint8_t ready;
+	uint16_t runs, overruns;
+	uint32_t wcet;		/* longest run in HAL_TICK_CLOCK counts */
+} sched_task;
+
+void sched_init(uint16_t top);
+sched_task *sched_add(const char *name, sched_fn run, uint16_t period, uint8_t prio);
+void sched_tick(void);
+void sched_post(sched_task *t);
+void sched_run(void);
+void sched_period(sched_task *t, uint16_t period);
+uint32_t sched_clock(void);
+uint32_t sched_ticks(void);
+void sched_report(void);
+
+#endif
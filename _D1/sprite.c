@@ -0,0 +1,103 @@
+#include "sprite.h"
+
+void sprite_init(sprite *s, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t colour)
+{
+	s->vx = s->vy = 0;
+	s->w = w;
+	s->h = h;
+	s->colour = colour;
+	s->background = display.background;
+	s->drawn = 0;
+	sprite_place(s, x, y);
+}
+
+/* Moves to whole pixel x, y; drawn at the next sprite_draw() */
+void sprite_place(sprite *s, uint16_t x, uint16_t y)
+{
+	s->x = x << SPRITE_FRAC;
+	s->y = y << SPRITE_FRAC;
+}
+
+void sprite_step(sprite *s)
+{
+	s->x += s->vx;
+	s->y += s->vy;
+	if (s->x < 0) s->x = 0;
+	if (s->y < 0) s->y = 0;
+}
+
+/* The rectangle it would be drawn at now */
+rectangle sprite_rect(const sprite *s)
+{
+	rectangle r;
+	r.left = s->x >> SPRITE_FRAC;
+	r.top = s->y >> SPRITE_FRAC;
+	r.right = r.left + s->w - 1;
+	r.bottom = r.top + s->h - 1;
+	return r;
+}
+
+/* The smallest rectangle holding both */
+static rectangle bounds(rectangle a, rectangle b)
+{
+	if (b.left < a.left) a.left = b.left;
+	if (b.right > a.right) a.right = b.right;
+	if (b.top < a.top) a.top = b.top;
+	if (b.bottom > a.bottom) a.bottom = b.bottom;
+	return a;
+}
+
+void sprite_draw(sprite *s)
+{
+	rectangle r = sprite_rect(s);
+	if (!s->drawn) {
+		lcd_sync(r);
+		fill_rectangle(r, s->colour);
+		s->drawn = 1;
+	} else if (r.left != s->shown.left || r.top != s->shown.top) {
+		lcd_sync(bounds(r, s->shown));
+		fill_minus(s->shown, r, s->background);
+		fill_minus(r, s->shown, s->colour);
+	}
+	s->shown = r;
+}
+
+void sprite_erase(sprite *s)
+{
+	if (s->drawn) {
+		lcd_sync(s->shown);
+		fill_rectangle(s->shown, s->background);
+	}
+	s->drawn = 0;
+}
+
+/* Fills the part of a outside b, at most four rectangles */
+void fill_minus(rectangle a, rectangle b, uint16_t col)
+{
+	rectangle r = a;
+	if (a.right < b.left || b.right < a.left || a.bottom < b.top || b.bottom < a.top) {
+		fill_rectangle(a, col);
+		return;
+	}
+	if (a.top < b.top) {
+		r.bottom = b.top - 1;
+		fill_rectangle(r, col);
+	}
+	if (a.bottom > b.bottom) {
+		r.top = b.bottom + 1;
+		r.bottom = a.bottom;
+		fill_rectangle(r, col);
+	}
+	r.top = a.top > b.top ? a.top : b.top;
+	r.bottom = a.bottom < b.bottom ? a.bottom : b.bottom;
+	if (a.left < b.left) {
+		r.left = a.left;
+		r.right = b.left - 1;
+		fill_rectangle(r, col);
+	}
+	if (a.right > b.right) {
+		r.left = b.right + 1;
+		r.right = a.right;
+		fill_rectangle(r, col);
+	}
+}
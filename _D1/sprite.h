@@ -0,0 +1,44 @@
+#ifndef SPRITE_H
+#define SPRITE_H
+
+#include <stdint.h>
+#include "lcd.h"
+
+/* Solid rectangular sprites over lcd.c, redrawn as deltas.
+ *
+ * A sprite remembers the rectangle it was last drawn at. sprite_draw()
+ * paints only the strips it has left, in the background colour, and the
+ * strips it has entered, in its own: a 6x6 ball moving 2 pixels is 24
+ * pixels each way instead of 72 for an erase and redraw, and an
+ * unmoved sprite costs nothing. Sprites must not overlap each other.
+ *
+ * Positions and velocities are fixed point with SPRITE_FRAC fraction
+ * bits, so a sprite can move 1.7 pixels a frame and still look even;
+ * sprite_step() adds the velocity once per frame. Positions stay at or
+ * above 0, the caller bounces them off the edges.
+ *
+ * With lcd_tear_sync() on, a move is drawn in one go behind the scan, so
+ * the panel never shows a sprite half way between two places.
+ */
+
+#define SPRITE_FRAC	6
+#define SPRITE_PX(p)	((int16_t)((p)*(1 << SPRITE_FRAC) + ((p) < 0 ? -0.5 : 0.5)))
+
+typedef struct {
+	int16_t x, y;		/* top left, SPRITE_FRAC fraction bits */
+	int16_t vx, vy;		/* per frame, same format */
+	uint16_t w, h;
+	uint16_t colour, background;
+	rectangle shown;	/* where it is on the panel */
+	uint8_t drawn;
+} sprite;
+
+void sprite_init(sprite *s, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t colour);
+void sprite_place(sprite *s, uint16_t x, uint16_t y);
+void sprite_step(sprite *s);
+rectangle sprite_rect(const sprite *s);
+void sprite_draw(sprite *s);
+void sprite_erase(sprite *s);
+void fill_minus(rectangle a, rectangle b, uint16_t col);
+
+#endif
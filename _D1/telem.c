@@ -0,0 +1,59 @@
+#include <util/crc16.h>
+#include "telem.h"
+#include "cobs.h"
+#include "hal.h"
+
+static volatile uint8_t enabled;
+static volatile uint16_t dropped;
+static uint16_t tick;
+
+void telem_enable(uint8_t on)
+{
+	enabled = on;
+}
+
+uint8_t telem_enabled(void)
+{
+	return enabled;
+}
+
+uint16_t telem_dropped(void)
+{
+	return dropped;
+}
+
+static uint8_t *put16(uint8_t *b, uint16_t x)
+{
+	b[0] = x;
+	b[1] = x >> 8;
+	return b + 2;
+}
+
+/* Called after pid_update(), from the ISR or with a copy of the state */
+void telem_record(uint16_t adc, const pid *p)
+{
+	uint8_t rec[TELEM_REC], frame[TELEM_FRAME], *b = rec, crc = 0, i;
+	int32_t duty = p->duty >> (PID_DBITS - 16);
+
+	if (!enabled)
+		return;
+	if (duty < 0) duty = 0;
+	if (duty > 0xffff) duty = 0xffff;
+	b = put16(b, tick++);
+	b = put16(b, adc);
+	b = put16(b, p->error);
+	b = put16(b, p->error_int);
+	b = put16(b, duty);
+	for (i = 0; i < TELEM_REC - 1; i++)
+		crc = _crc8_ccitt_update(crc, rec[i]);
+	*b = crc;
+
+	if (hal_uart_tx_free() < TELEM_FRAME) {
+		dropped++;
+		return;
+	}
+	cobs_encode(rec, TELEM_REC, frame);
+	frame[TELEM_FRAME - 1] = 0;
+	for (i = 0; i < TELEM_FRAME; i++)
+		hal_uart_putc(frame[i]);
+}
@@ -0,0 +1,31 @@
+#ifndef TELEM_H
+#define TELEM_H
+
+#include <stdint.h>
+#include "pid.h"
+
+/* Binary telemetry, one record per telem_record() call.
+ *
+ * A record is TELEM_REC bytes, little endian:
+ *   0  uint16 tick      counts every telem_record() call, so the host sees
+ *                       dropped records as gaps
+ *   2  uint16 adc       raw reading, ADC_BITS wide
+ *   4  int16  error     Q5.10 volts
+ *   6  int16  integral  Q0.15 volt-seconds
+ *   8  uint16 duty      Q0.16
+ *   10 uint8  crc       CRC-8 (poly 0x07) of bytes 0-9
+ * It is sent COBS encoded and ended by a zero byte, TELEM_FRAME bytes in
+ * all, against about 140 for a printf line of the same values. A frame is
+ * only queued when the UART ring has room for all of it, otherwise the
+ * record is dropped whole. telemdec (make host) decodes the stream.
+ */
+
+#define TELEM_REC	11
+#define TELEM_FRAME	(TELEM_REC + 2)
+
+void telem_enable(uint8_t on);
+uint8_t telem_enabled(void);
+void telem_record(uint16_t adc, const pid *p);
+uint16_t telem_dropped(void);
+
+#endif
@@ -0,0 +1,219 @@
+/*   telemdec.c
+ *
+ *   Host decoder for the binary telemetry stream of telem.c. Splits the
+ *   input at zero bytes, COBS decodes each frame and checks its CRC, then
+ *   writes one row per record. Text between frames, e.g. replies to
+ *   commands, is skipped. A repeated record, one with the tick of the one
+ *   before, is dropped. A summary of good, bad, missing and repeated
+ *   records goes to stderr.
+ *
+ *   make host
+ *   printf 't1\n' | HAL_TICKS=2000 ./boost_host | ./telemdec -o step.csv
+ *   ./telemdec -f col -o log.tlm /dev/ttyUSB0
+ *
+ *   Options:
+ *     -f csv|col   output format (default csv)
+ *     -o file      output file (default stdout)
+ *     -T seconds   time per record (default 1/TELEM_HZ)
+ *
+ *   The col format holds each column contiguously, for loading without
+ *   parsing:
+ *     "TLM1", uint32 rows, uint32 cols
+ *     cols x { char name[12], char type[4] }   type "u4", "u2" or "f8"
+ *     then for each column, rows values, little endian
+ *   e.g. in numpy, np.fromfile(f, "<f8", rows, offset=...) per column.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <util/crc16.h>
+
+#include "telem.h"
+#include "cobs.h"
+#include "adc.h"
+
+#define TELEM_HZ	200	/* send_telem() rate in boost.c, at 57600 baud */
+
+typedef struct {
+	uint32_t tick;
+	uint16_t adc;
+	double vout, error, integral, duty;
+} row;
+
+static row *rows;
+static size_t nrows, cap;
+static unsigned long good, bad, missing, dups;
+static uint32_t last_tick;
+
+static uint16_t get16(const uint8_t *b)
+{
+	return b[0] | b[1] << 8;
+}
+
+static void frame(const uint8_t *buf, size_t n)
+{
+	uint8_t rec[TELEM_REC], crc = 0;
+	uint16_t t;
+	row *r;
+	int i;
+
+	if (cobs_decode(buf, n, rec) != TELEM_REC) {
+		bad++;
+		return;
+	}
+	for (i = 0; i < TELEM_REC - 1; i++)
+		crc = _crc8_ccitt_update(crc, rec[i]);
+	if (crc != rec[TELEM_REC - 1]) {
+		bad++;
+		return;
+	}
+	t = get16(rec);
+	/* The same tick again is a repeated frame, not a 65535 record gap */
+	if (good && t == (uint16_t)last_tick) {
+		dups++;
+		return;
+	}
+
+	if (nrows == cap) {
+		cap = cap ? 2*cap : 4096;
+		rows = realloc(rows, cap*sizeof(row));
+		if (!rows) {
+			perror("telemdec");
+			exit(1);
+		}
+	}
+	r = &rows[nrows++];
+	/* Unwrap the 16-bit tick; gaps, d of 2 or more, are records the
+	 * firmware dropped
+	 */
+	if (good) {
+		uint16_t d = t - (uint16_t)last_tick;
+		r->tick = last_tick + d;
+		missing += d - 1;
+	} else {
+		r->tick = t;
+	}
+	last_tick = r->tick;
+	good++;
+
+	r->adc = get16(rec + 2);
+	r->vout = (double)r->adc*PID_VREF/((uint32_t)PID_ADCMAX << ADC_OSR_BITS)/PID_VDIV;
+	r->error = (int16_t)get16(rec + 4)/(double)(1 << PID_VBITS);
+	r->integral = (int16_t)get16(rec + 6)/32768.0;
+	r->duty = get16(rec + 8)/65536.0;
+}
+
+static void put32(FILE *f, uint32_t x)
+{
+	fwrite(&x, 4, 1, f);	/* host is little endian */
+}
+
+static void column(FILE *f, const char *name, const char *type)
+{
+	char n[12] = {0}, t[4] = {0};
+	memcpy(n, name, strlen(name));		/* names fit, no terminator needed */
+	memcpy(t, type, strlen(type));
+	fwrite(n, 1, sizeof(n), f);
+	fwrite(t, 1, sizeof(t), f);
+}
+
+static void write_col(FILE *f, double tick_s)
+{
+	size_t i;
+
+	fwrite("TLM1", 1, 4, f);
+	put32(f, nrows);
+	put32(f, 7);
+	column(f, "tick", "u4");
+	column(f, "time", "f8");
+	column(f, "adc", "u2");
+	column(f, "vout", "f8");
+	column(f, "error", "f8");
+	column(f, "integral", "f8");
+	column(f, "duty", "f8");
+	for (i = 0; i < nrows; i++) fwrite(&rows[i].tick, 4, 1, f);
+	for (i = 0; i < nrows; i++) {
+		double t = rows[i].tick*tick_s;
+		fwrite(&t, 8, 1, f);
+	}
+	for (i = 0; i < nrows; i++) fwrite(&rows[i].adc, 2, 1, f);
+	for (i = 0; i < nrows; i++) fwrite(&rows[i].vout, 8, 1, f);
+	for (i = 0; i < nrows; i++) fwrite(&rows[i].error, 8, 1, f);
+	for (i = 0; i < nrows; i++) fwrite(&rows[i].integral, 8, 1, f);
+	for (i = 0; i < nrows; i++) fwrite(&rows[i].duty, 8, 1, f);
+}
+
+static void write_csv(FILE *f, double tick_s)
+{
+	size_t i;
+
+	fprintf(f, "tick,time,adc,vout,error,integral,duty\n");
+	for (i = 0; i < nrows; i++) {
+		row *r = &rows[i];
+		fprintf(f, "%u,%.6f,%u,%.4f,%.4f,%.6f,%.5f\n", r->tick, r->tick*tick_s,
+			r->adc, r->vout, r->error, r->integral, r->duty);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const char *fmt = "csv", *out = NULL;
+	double tick_s = 1.0/TELEM_HZ;
+	uint8_t buf[256];
+	size_t n = 0;
+	FILE *in = stdin, *f = stdout;
+	int c;
+
+	while ((c = getopt(argc, argv, "f:o:T:")) != -1) {
+		switch (c) {
+		case 'f': fmt = optarg; break;
+		case 'o': out = optarg; break;
+		case 'T': tick_s = atof(optarg); break;
+		default:
+			fprintf(stderr, "usage: telemdec [-f csv|col] [-o file] [-T seconds] [input]\n");
+			return 1;
+		}
+	}
+	if (strcmp(fmt, "csv") && strcmp(fmt, "col")) {
+		fprintf(stderr, "telemdec: unknown format %s\n", fmt);
+		return 1;
+	}
+	if (optind < argc && !(in = fopen(argv[optind], "rb"))) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	/* A frame is the last TELEM_FRAME - 1 bytes before a zero; text
+	   written between frames is skipped */
+	while ((c = getc(in)) != EOF) {
+		if (c == 0) {
+			if (n >= TELEM_FRAME - 1)
+				frame(buf + n - (TELEM_FRAME - 1), TELEM_FRAME - 1);
+			else if (n)
+				bad++;
+			n = 0;
+		} else {
+			if (n == sizeof(buf)) {
+				memmove(buf, buf + n - TELEM_FRAME, TELEM_FRAME);
+				n = TELEM_FRAME;
+			}
+			buf[n++] = c;
+		}
+	}
+
+	if (out && !(f = fopen(out, "wb"))) {
+		perror(out);
+		return 1;
+	}
+	if (!strcmp(fmt, "csv"))
+		write_csv(f, tick_s);
+	else
+		write_col(f, tick_s);
+	if (f != stdout) fclose(f);
+
+	fprintf(stderr, "telemdec: %lu records, %lu bad frames, %lu missing, %lu repeated\n",
+		good, bad, missing, dups);
+	return 0;
+}
@@ -0,0 +1,369 @@
+/*   tune.c
+ *
+ *   Host tool that searches PID gains for boost.c against the plant model.
+ *   Each gain set runs the fixed-point controller (pid.c) at the firmware
+ *   tick rate on every target voltage and load in the scenario list; the
+ *   worst settling time, overshoot, ripple and IAE across the scenarios
+ *   are its score. Runs are spread over all cores by a work-stealing pool.
+ *
+ *   Prints the Pareto front as CSV and a gain set to paste into boost.c.
+ *
+ *   make tune
+ *   ./tune -p 1e-4:1e-2:20 -i 1e-5:1e-2:20 -d 1e-5:1e-2:20 -v 8,10,12 -r 50,100,500
+ *   ./tune -e 200 -n 512        (evolutionary search instead of a grid)
+ *
+ *   Options:
+ *     -p/-i/-d lo:hi:n  log spaced grid for kP, kI, kD
+ *     -v list          target voltages
+ *     -r list          load resistances
+ *     -t seconds       simulated time per run (default 2)
+ *     -j threads       worker threads (default: all cores)
+ *     -e gens -n pop   evolutionary search
+ *     -s seed          random seed for -e
+ *     -o file          also write every candidate as CSV
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "pid.h"
+#include "plant.h"
+#include "adc.h"
+
+#define TICK_TOP	1499	/* OCR1A in boost.c, HAL_TICK_TOP(CTRL_HZ) */
+#define TICK_S		((TICK_TOP + 1)*8.0/F_CPU)
+/* boost.c's PID_DT: a per-step scaling kept from its old 100 Hz tick,
+ * not TICK_S; the search keeps it so its gains paste over.
+ */
+#define PID_DT		0.01
+#define PWM_DUTY_MAX	240
+#define BAND		0.02	/* settling band, fraction of target */
+#define MAX_LIST	16
+
+typedef struct {
+	double kP, kI, kD;
+	double settle, overshoot, ripple, iae;	/* worst case over scenarios */
+	double cost;
+} candidate;
+
+typedef struct {
+	double lo, hi;
+	int n;
+} range;
+
+static double targets[MAX_LIST] = {8, 10, 12};
+static double loads[MAX_LIST] = {50, 100, 500};
+static int ntargets = 3, nloads = 3;
+static double sim_time = 2.0;
+
+/* One run of the controller from power up, sampled once per tick */
+static void simulate(candidate *c, double target, double load,
+		     double *settle, double *overshoot, double *ripple, double *iae)
+{
+	plant p;
+	pid ctrl;
+	double t = 0.0, vmax = 0.0, rmin = 1e9, rmax = -1e9, e;
+	double rip_from = sim_time*0.75;
+	uint8_t ocr = 0, crossed = 0;
+	long ticks = (long)(sim_time/TICK_S), k;
+
+	plant_init(&p);
+	p.r = load;
+	pid_init(&ctrl, PID_DT, 0.3, 0.1, 0.95);
+	pid_set_gains(&ctrl, c->kP, c->kI, c->kD);
+	ctrl.target = PID_V(target);
+
+	*settle = 0.0;
+	*iae = 0.0;
+	for (k = 0; k < ticks; k++) {
+		pid_update(&ctrl, PID_ADCX_TO_V(plant_adc(&p, ADC_OSR_BITS), ADC_OSR_BITS));
+		ocr = pid_pwm(&ctrl, PWM_DUTY_MAX);
+		plant_run(&p, plant_duty(ocr), TICK_S);
+		t += TICK_S;
+		e = p.vout - target;
+		*iae += fabs(e)*TICK_S;
+		if (fabs(e) > BAND*target)
+			*settle = t;
+		if (e >= 0.0)
+			crossed = 1;
+		if (crossed && p.vout > vmax)
+			vmax = p.vout;
+		if (t >= rip_from) {
+			if (p.vout < rmin) rmin = p.vout;
+			if (p.vout > rmax) rmax = p.vout;
+		}
+	}
+	*overshoot = crossed ? 100.0*(vmax - target)/target : 0.0;
+	*ripple = rmax - rmin;
+}
+
+static void evaluate(candidate *c)
+{
+	double st, os, rp, ia;
+	int i, j;
+
+	c->settle = c->overshoot = c->ripple = c->iae = 0.0;
+	for (i = 0; i < ntargets; i++)
+		for (j = 0; j < nloads; j++) {
+			simulate(c, targets[i], loads[j], &st, &os, &rp, &ia);
+			if (st > c->settle) c->settle = st;
+			if (os > c->overshoot) c->overshoot = os;
+			if (rp > c->ripple) c->ripple = rp;
+			if (ia > c->iae) c->iae = ia;
+		}
+	/* Scalar score for the evolutionary search and the final pick */
+	c->cost = c->iae + c->settle + 0.05*c->overshoot + c->ripple;
+}
+
+/* Work-stealing pool: every worker owns a range of indices and takes the
+ * upper half of another worker's range when its own runs dry.
+ */
+typedef struct {
+	pthread_mutex_t lock;
+	size_t lo, hi;
+} queue;
+
+static queue *queues;
+static int nthreads;
+static candidate *work;
+
+static int pop(queue *q, size_t *i)
+{
+	int ok;
+	pthread_mutex_lock(&q->lock);
+	ok = q->lo < q->hi;
+	if (ok) *i = q->lo++;
+	pthread_mutex_unlock(&q->lock);
+	return ok;
+}
+
+static int steal(int self)
+{
+	int k, v;
+	size_t lo = 0, hi = 0;
+
+	for (k = 1; k < nthreads && lo == hi; k++) {
+		v = (self + k) % nthreads;
+		pthread_mutex_lock(&queues[v].lock);
+		if (queues[v].hi - queues[v].lo > 1) {
+			lo = queues[v].lo + (queues[v].hi - queues[v].lo)/2;
+			hi = queues[v].hi;
+			queues[v].hi = lo;
+		}
+		pthread_mutex_unlock(&queues[v].lock);
+	}
+	if (lo == hi)
+		return 0;
+	pthread_mutex_lock(&queues[self].lock);
+	queues[self].lo = lo;
+	queues[self].hi = hi;
+	pthread_mutex_unlock(&queues[self].lock);
+	return 1;
+}
+
+static void *worker(void *arg)
+{
+	int self = (int)(size_t)arg;
+	size_t i;
+	for (;;) {
+		while (pop(&queues[self], &i))
+			evaluate(&work[i]);
+		if (!steal(self))
+			return NULL;
+	}
+}
+
+static void run_pool(candidate *c, size_t n)
+{
+	pthread_t *th = malloc(nthreads*sizeof(*th));
+	int t;
+
+	work = c;
+	for (t = 0; t < nthreads; t++) {
+		queues[t].lo = n*t/nthreads;
+		queues[t].hi = n*(t + 1)/nthreads;
+	}
+	for (t = 0; t < nthreads; t++)
+		pthread_create(&th[t], NULL, worker, (void *)(size_t)t);
+	for (t = 0; t < nthreads; t++)
+		pthread_join(th[t], NULL);
+	free(th);
+}
+
+static double grid_at(range r, int i)
+{
+	return (r.n < 2) ? r.lo : r.lo*pow(r.hi/r.lo, (double)i/(r.n - 1));
+}
+
+static uint64_t rng = 88172645463325252ull;
+
+static double uniform(void)
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 7;
+	rng ^= rng << 17;
+	return (rng >> 11)*(1.0/9007199254740992.0);
+}
+
+static double log_uniform(range r)
+{
+	return r.lo*pow(r.hi/r.lo, uniform());
+}
+
+static double mutate(double g, range r)
+{
+	g *= exp(0.3*(uniform() + uniform() + uniform() - 1.5));
+	if (g < r.lo) g = r.lo;
+	if (g > r.hi) g = r.hi;
+	return g;
+}
+
+static int by_cost(const void *a, const void *b)
+{
+	double d = ((const candidate *)a)->cost - ((const candidate *)b)->cost;
+	return (d > 0) - (d < 0);
+}
+
+static int dominates(const candidate *a, const candidate *b)
+{
+	return a->settle <= b->settle && a->overshoot <= b->overshoot &&
+	       a->ripple <= b->ripple && a->iae <= b->iae &&
+	       (a->settle < b->settle || a->overshoot < b->overshoot ||
+		a->ripple < b->ripple || a->iae < b->iae);
+}
+
+/* Candidates sorted by cost, so nothing can dominate an earlier entry
+ * that is already on the front.
+ */
+static size_t pareto(candidate *c, size_t n, candidate *front)
+{
+	size_t i, j, nf = 0;
+	qsort(c, n, sizeof(*c), by_cost);
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < nf; j++)
+			if (dominates(&front[j], &c[i]))
+				break;
+		if (j == nf)
+			front[nf++] = c[i];
+	}
+	return nf;
+}
+
+static int parse_range(const char *s, range *r)
+{
+	return sscanf(s, "%lf:%lf:%d", &r->lo, &r->hi, &r->n) == 3 && r->lo > 0 && r->hi >= r->lo && r->n > 0;
+}
+
+static int parse_list(const char *s, double *v)
+{
+	int n = 0;
+	char *end;
+	while (*s && n < MAX_LIST) {
+		v[n++] = strtod(s, &end);
+		if (end == s) return 0;
+		s = (*end == ',') ? end + 1 : end;
+	}
+	return n;
+}
+
+static void write_csv(FILE *f, const candidate *c, size_t n)
+{
+	size_t i;
+	fprintf(f, "kP,kI,kD,settle_s,overshoot_pct,ripple_v,iae_vs\n");
+	for (i = 0; i < n; i++)
+		fprintf(f, "%.6g,%.6g,%.6g,%.4f,%.3f,%.4f,%.5f\n", c[i].kP, c[i].kI, c[i].kD,
+			c[i].settle, c[i].overshoot, c[i].ripple, c[i].iae);
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: tune [-p|-i|-d lo:hi:n] [-v list] [-r list] [-t s] [-j n] [-e gens -n pop] [-s seed] [-o file]\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	range rp = {1e-4, 1e-2, 20}, ri = {1e-5, 1e-2, 20}, rd = {1e-5, 1e-2, 20};
+	int gens = 0, pop_size = 256, opt, g, a, b, d;
+	size_t n, i, nf;
+	candidate *c, *front;
+	const char *out = NULL;
+	FILE *f;
+
+	nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	while ((opt = getopt(argc, argv, "p:i:d:v:r:t:j:e:n:s:o:")) != -1) {
+		switch (opt) {
+		case 'p': if (!parse_range(optarg, &rp)) usage(); break;
+		case 'i': if (!parse_range(optarg, &ri)) usage(); break;
+		case 'd': if (!parse_range(optarg, &rd)) usage(); break;
+		case 'v': if (!(ntargets = parse_list(optarg, targets))) usage(); break;
+		case 'r': if (!(nloads = parse_list(optarg, loads))) usage(); break;
+		case 't': sim_time = atof(optarg); break;
+		case 'j': nthreads = atoi(optarg); break;
+		case 'e': gens = atoi(optarg); break;
+		case 'n': pop_size = atoi(optarg); break;
+		case 's': rng = strtoull(optarg, NULL, 0) | 1; break;
+		case 'o': out = optarg; break;
+		default: usage();
+		}
+	}
+	if (nthreads < 1 || sim_time <= 0.0 || pop_size < 2)
+		usage();
+	queues = calloc(nthreads, sizeof(*queues));
+	for (g = 0; g < nthreads; g++)
+		pthread_mutex_init(&queues[g].lock, NULL);
+
+	if (gens > 0) {
+		/* (mu + lambda): the better half survives, mutants refill the rest */
+		n = pop_size;
+		c = calloc(n, sizeof(*c));
+		for (i = 0; i < n; i++) {
+			c[i].kP = log_uniform(rp);
+			c[i].kI = log_uniform(ri);
+			c[i].kD = log_uniform(rd);
+		}
+		run_pool(c, n);
+		for (g = 1; g < gens; g++) {
+			qsort(c, n, sizeof(*c), by_cost);
+			for (i = n/2; i < n; i++) {
+				c[i] = c[i - n/2];
+				c[i].kP = mutate(c[i].kP, rp);
+				c[i].kI = mutate(c[i].kI, ri);
+				c[i].kD = mutate(c[i].kD, rd);
+			}
+			run_pool(c + n/2, n - n/2);
+			fprintf(stderr, "generation %d: best cost %.5f\n", g, c[0].cost);
+		}
+	} else {
+		n = (size_t)rp.n*ri.n*rd.n;
+		c = calloc(n, sizeof(*c));
+		for (a = 0, i = 0; a < rp.n; a++)
+			for (b = 0; b < ri.n; b++)
+				for (d = 0; d < rd.n; d++, i++) {
+					c[i].kP = grid_at(rp, a);
+					c[i].kI = grid_at(ri, b);
+					c[i].kD = grid_at(rd, d);
+				}
+		fprintf(stderr, "%zu gain sets x %d scenarios on %d threads\n", n, ntargets*nloads, nthreads);
+		run_pool(c, n);
+	}
+
+	front = malloc(n*sizeof(*front));
+	nf = pareto(c, n, front);
+	if (out && (f = fopen(out, "w"))) {
+		write_csv(f, c, n);
+		fclose(f);
+	}
+	write_csv(stdout, front, nf);
+
+	/* Lowest cost is first on the front */
+	printf("\n/* tune: settle %.3f s, overshoot %.2f %%, ripple %.3f V, IAE %.4f V s */\n",
+	       front[0].settle, front[0].overshoot, front[0].ripple, front[0].iae);
+	printf("volatile double kP = %.6g;\nvolatile double kI = %.6g;\nvolatile double kD = %.6g;\n",
+	       front[0].kP, front[0].kI, front[0].kD);
+	return 0;
+}
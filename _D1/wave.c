@@ -0,0 +1,128 @@
+#include "wave.h"
+
+#define MIN_SPAN	8	/* narrowest scale, in sample units */
+
+static void open_bucket(wave_bucket *b)
+{
+	b->min = 0xFF;
+	b->max = 0;
+	b->last = 0;
+}
+
+void wave_init(wave *w, wave_bucket *b, uint16_t n, uint16_t decim)
+{
+	uint16_t i;
+	w->b = b;
+	w->n = n;
+	w->decim = decim ? decim : 1;
+	w->count = 0;
+	w->head = w->tail = 0;
+	w->prev = 0;
+	w->lo = 0;
+	w->hi = 0xFF;
+	for (i = 0; i < n; i++)
+		open_bucket(&b[i]);
+}
+
+/* Called from the sampling ISR only */
+void wave_sample(wave *w, uint8_t v)
+{
+	wave_bucket *b = &w->b[w->head];
+	uint16_t h;
+	if (v < b->min) b->min = v;
+	if (v > b->max) b->max = v;
+	b->last = v;
+	if (++w->count < w->decim)
+		return;
+	w->count = 0;
+	h = w->head + 1;
+	if (h == w->n) h = 0;
+	open_bucket(&w->b[h]);
+	w->head = h;
+}
+
+/* Two equal reads in a row cannot straddle a wave_sample() update */
+static uint16_t read_head(wave *w)
+{
+	uint16_t h;
+	do
+		h = w->head;
+	while (h != w->head);
+	return h;
+}
+
+static uint16_t to_x(const wave *w, const chart *c, uint8_t v)
+{
+	if (v <= w->lo) return 0;
+	if (v >= w->hi) return c->width - 1;
+	return (uint32_t)(v - w->lo)*(c->width - 1)/(w->hi - w->lo);
+}
+
+static void draw_bucket(wave *w, chart *c, const wave_bucket *b)
+{
+	uint8_t lo = b->min, hi = b->max;
+	if (lo > hi) {
+		chart_span(c, 1, 0);
+		return;
+	}
+	if (w->prev < lo) lo = w->prev;
+	if (w->prev > hi) hi = w->prev;
+	chart_span(c, to_x(w, c, lo), to_x(w, c, hi));
+	w->prev = b->last;
+}
+
+/* Range of every closed bucket; returns 0 if there are none */
+static uint8_t extent(const wave *w, uint16_t head, uint8_t *lo, uint8_t *hi)
+{
+	uint16_t i;
+	*lo = 0xFF;
+	*hi = 0;
+	for (i = 0; i < w->n; i++) {
+		if (i == head || w->b[i].min > w->b[i].max) continue;
+		if (w->b[i].min < *lo) *lo = w->b[i].min;
+		if (w->b[i].max > *hi) *hi = w->b[i].max;
+	}
+	return *lo <= *hi;
+}
+
+/* Draws the buckets closed since the last call and returns 1 if the
+ * scale was refitted, which redraws the whole band.
+ */
+uint8_t wave_draw(wave *w, chart *c)
+{
+	uint16_t head = read_head(w), i;
+	uint8_t dlo, dhi, lo, hi, m;
+
+	if (w->tail == head)
+		return 0;
+	if (!extent(w, head, &dlo, &dhi))
+		return 0;
+
+	m = (dhi - dlo)/8 + 1;
+	lo = dlo > m ? dlo - m : 0;
+	hi = dhi < 0xFF - m ? dhi + m : 0xFF;
+	if (hi - lo < MIN_SPAN) {
+		if (lo > 0xFF - MIN_SPAN) lo = 0xFF - MIN_SPAN;
+		hi = lo + MIN_SPAN;
+	}
+	if (dlo < w->lo || dhi > w->hi || (uint16_t)(hi - lo)*2 < w->hi - w->lo) {
+		if (!chart_begin(c, w->n))
+			return 0;
+		w->lo = lo;
+		w->hi = hi;
+		/* oldest first, with the open bucket's row left blank */
+		chart_span(c, 1, 0);
+		w->tail = head + 1 == w->n ? 0 : head + 1;
+		w->prev = w->b[w->tail].min;
+		for (; w->tail != head; w->tail = w->tail + 1 == w->n ? 0 : w->tail + 1)
+			draw_bucket(w, c, &w->b[w->tail]);
+		return 1;
+	}
+
+	if (!chart_begin(c, head >= w->tail ? head - w->tail : head + w->n - w->tail))
+		return 0;
+	for (i = w->tail; i != head; i = i + 1 == w->n ? 0 : i + 1)
+		draw_bucket(w, c, &w->b[i]);
+	w->tail = head;
+	return 0;
+}
@@ -0,0 +1,48 @@
+#ifndef WAVE_H
+#define WAVE_H
+
+#include <stdint.h>
+#include "chart.h"
+
+/* Min/max decimating waveform history for chart.c.
+ *
+ * wave_sample() runs in the control ISR at the full sample rate and
+ * folds each 8-bit sample into the open bucket: the lowest, highest and
+ * last value seen. Every decim samples the bucket is closed and the next
+ * one in the ring opened. wave_draw() in the main loop renders each closed
+ * bucket as one chart row from its min to its max, extended to the last
+ * value of the bucket before (a Bresenham line between rows one pixel
+ * apart), so ripple and single-sample spikes stay visible however slowly
+ * the display keeps up. The ring is 3 bytes a bucket, held by the caller,
+ * with one bucket per row of the chart band.
+ *
+ * The Y axis follows the data: when the history leaves lo..hi, or a
+ * refit would be under half as wide, the scale is refitted with an eighth
+ * of margin each side and the band redrawn from the ring.
+ *
+ * Under lcd_tear_sync() wave_draw() only draws while chart_begin() lets
+ * it, and otherwise leaves the rows for a later call: a main loop that
+ * calls it at least every millisecond or so gets them all out once a
+ * refresh, tear free.
+ */
+
+typedef struct {
+	uint8_t min, max, last;	/* min above max: no samples yet */
+} wave_bucket;
+
+typedef struct {
+	wave_bucket *b;
+	uint16_t n;		/* buckets in b, rows in the chart band */
+	uint16_t decim;		/* samples per bucket */
+	uint16_t count;		/* samples in the open bucket */
+	volatile uint16_t head;	/* open bucket, moved by wave_sample() */
+	uint16_t tail;		/* next closed bucket to draw */
+	uint8_t prev;		/* last value of the bucket drawn before tail */
+	uint8_t lo, hi;		/* values at the left and right of the chart */
+} wave;
+
+void wave_init(wave *w, wave_bucket *b, uint16_t n, uint16_t decim);
+void wave_sample(wave *w, uint8_t v);
+uint8_t wave_draw(wave *w, chart *c);
+
+#endif
@@ -3,9 +3,8 @@
  * 
  *          - F_CPU must be defined to match the clock frequency
  *
- *          - Compile with the options to enable floating point
- *            numbers in printf(): 
- *               -Wl,-u,vfprintf -lprintf_flt -lm
+ *          - Numbers are formatted by fmt.c, so the floating point
+ *            printf (-u vfprintf -lprintf_flt) is not needed
  *
  *          - Pin assignment: 
  *            | Port | Pin | Use                         |
@@ -16,7 +15,7 @@
  *            | D    | PD7 | PWM out to drive MOSFET     |
  */
 
- // avr-gcc -u vfprintf -lprintf_flt -lm -mmcu=atmega644p -DF_CPU=12000000 -Wall -Os embedded_boost.c -o boost.elf
+ // avr-gcc -mmcu=atmega644p -DF_CPU=12000000 -Wall -Os workingBoost.c -o boost.elf -L. -llcd -lm
  //avr-objcopy -O ihex boost.elf boost.hex
  //avrdude -c usbasp -p m644p -U flash:w:boost.hex
  
@@ -26,8 +25,13 @@
 #include <math.h>
 #include <avr/interrupt.h>
 
+#include "pid.h"
+#include "adc.h"
+#include "hal.h"
+#include "fmt.h"
+
 #define DELAY_MS      100
-#define BDRATE_BAUD  9600 //speed of the code
+#define BDRATE_BAUD  250000 //exact from 12 MHz, the log is queued for USART0_UDRE_vect
 
 #define ADCREF_V     3.3 //reference voltage
 #define ADCMAXREAD   1023   /* 10 bit ADC */
@@ -37,27 +41,15 @@
 */
 #define PWM_DUTY_MAX 240    /* 94% duty cycle */
 
-volatile double error = 0.0;
-
-volatile double errorPrev = 0.0;
-
-volatile double errorInt = 0.0;
-
-volatile double errorDiff = 0.0;
-
-volatile double dutyCycle = 0.6;
+pid ctrl;
 
 volatile double targetVoltage = 10.0; 
 
-void init_stdio2uart0(void);
-int uputchar0(char c, FILE *stream);
-int ugetchar0(FILE *stream);
 		
-void init_adc(void);
 double v_load(void);
 
 void init_pwm(void);
-void pwm_duty(double dutyCycle);
+void pwm_duty(uint8_t x);
 
 void init_counter(void);
 
@@ -70,6 +62,7 @@ ISR(INT1_vect){
 	}	else {
 		targetVoltage = 5;
 	}
+	ctrl.target = PID_V(targetVoltage);
 }
 
 ISR(INT0_vect){
@@ -79,21 +72,12 @@ ISR(INT0_vect){
 	}	else {
 		targetVoltage = 5;
 	}
+	ctrl.target = PID_V(targetVoltage);
 }
 
 ISR(TIMER1_COMPA_vect){
-	error = (v_load()/0.176) - targetVoltage;
-    errorInt = (error + errorInt)*0.01;
-    errorDiff = (error - errorPrev)/0.01;
-    double kP=0.002;
-    double kI=0.02;
-    double kD=0.0001;
-    dutyCycle = dutyCycle - ((error*kP) + (errorInt*kI) + (errorDiff*kD));
-	if(dutyCycle>0.95 || dutyCycle<0.1){
-		dutyCycle = 0.5;
-	}
-    errorPrev = error;
-	pwm_duty(dutyCycle);
+	pid_update(&ctrl, PID_ADCX_TO_V(adc_latest(), ADC_OSR_BITS));
+	pwm_duty(pid_pwm(&ctrl, PWM_DUTY_MAX));
 }
 
 
@@ -101,9 +85,14 @@ int main(void)
 {
 	uint16_t cnt =0;
         	
-	init_stdio2uart0();
+	hal_uart_init(BDRATE_BAUD);
+	hal_stdio_init();
 	init_pwm(); 
-	init_adc();
+	adc_init(1);
+	pid_init(&ctrl, 0.01, 0.5, 0.1, 0.95);
+	ctrl.duty = PID_DUTY(0.6);
+	pid_set_gains(&ctrl, 0.002, 0.02, 0.0001);
+	ctrl.target = PID_V(targetVoltage);
 	init_counter();
 
 	EIMSK |= _BV(INT0);
@@ -111,64 +100,26 @@ int main(void)
 	
 	sei();
 
+	char pin_s[FMT_BUF], vout_s[FMT_BUF], target_s[FMT_BUF];
+	char err_s[FMT_BUF], int_s[FMT_BUF], dif_s[FMT_BUF];
+
 	for(;;) {	    
 	    printf( "%04d:  ", cnt );
 	    
-		double voltage = v_load()/0.176;
-
-	    printf( " PWM = %4u -->  %5.3f V --> Boosted Voltage %5.3f --> Target voltage %5.3f      error%5.2f     errorInt%5.2f    errorDiff%5.2f\r\n", pwmGlobal ,v_load(),voltage, targetVoltage, error, errorInt, errorDiff);
+		uint16_t adc = adc_filtered();
+		fmt_dec(pin_s, (uint32_t)adc*3300/ADC_READ_MAX, 3, 5); //mV at PA0
+		fmt_fixed(vout_s, PID_ADCX_TO_V(adc, ADC_OSR_BITS), PID_VBITS, 3, 5);
+		fmt_fixed(target_s, ctrl.target, PID_VBITS, 3, 5);
+		fmt_fixed(err_s, ctrl.error, PID_VBITS, 2, 5);
+		fmt_fixed(int_s, ctrl.error_int, 15, 2, 5);
+		fmt_fixed(dif_s, ctrl.error_dif, PID_VBITS, 2, 5);
+
+	    printf( " PWM = %4u -->  %s V --> Boosted Voltage %s --> Target voltage %s      error%s     errorInt%s    errorDiff%s\r\n", pwmGlobal, pin_s, vout_s, target_s, err_s, int_s, dif_s);
 	    //_delay_ms(DELAY_MS);
 	    cnt++;
 	}
 }
 
-int uputchar0(char c, FILE *stream)
-{
-	if (c == '\n') uputchar0('\r', stream);
-	while (!(UCSR0A & _BV(UDRE0)));
-	UDR0 = c;
-	return c;
-}
-
-int ugetchar0(FILE *stream)
-{
-	while(!(UCSR0A & _BV(RXC0)));
-	return UDR0;
-}
-
-void init_stdio2uart0(void)
-{
-	/* Configure UART0 baud rate, one start bit, 8-bit, no parity and one stop bit */
-	UBRR0H = (F_CPU/(BDRATE_BAUD*16L)-1) >> 8;
-	UBRR0L = (F_CPU/(BDRATE_BAUD*16L)-1);
-	UCSR0B = _BV(RXEN0) | _BV(TXEN0);
-	UCSR0C = _BV(UCSZ00) | _BV(UCSZ01);
-
-	/* Setup new streams for input and output */
-	static FILE uout = FDEV_SETUP_STREAM(uputchar0, NULL, _FDEV_SETUP_WRITE);
-	static FILE uin = FDEV_SETUP_STREAM(NULL, ugetchar0, _FDEV_SETUP_READ);
-
-	/* Redirect all standard streams to UART0 */
-	stdout = &uout;
-	stderr = &uout;
-	stdin = &uin;
-}
-
-void init_adc (void)
-{
-    /* REFSx = 0 : Select AREF as reference
-     * ADLAR = 0 : Right shift result
-     *  MUXx = 0 : Default to channel 0
-     */
-    ADMUX = 0x01;
-    /*  ADEN = 1 : Enable the ADC
-     * ADPS2 = 1 : Configure ADC prescaler
-     * ADPS1 = 1 : F_ADC = F_CPU / 64
-     * ADPS0 = 0 :       = 187.5 kHz
-     */
-    ADCSRA = _BV(ADEN) | _BV(ADPS2) | _BV(ADPS1);
-}
-
 void init_counter(void){
 	
 	//initilise the counter in fast pwm mode
@@ -187,17 +138,11 @@ void init_counter(void){
 
 double v_load(void)
 {
-     uint16_t adcread;
-         
-     /* Start single conversion */
-     ADCSRA |= _BV ( ADSC );
-     /* Wait for conversion to complete */
-     while ( ADCSRA & _BV ( ADSC ) );
-     adcread = ADC;
+     uint16_t adcread = adc_filtered();
     
      //printf("ADC=%4d", adcread);  
  
-     return (double) (adcread * ADCREF_V/ADCMAXREAD);
+     return (double) (adcread * ADCREF_V/ADC_READ_MAX);
 }
 
 void init_pwm(void)
@@ -219,10 +164,8 @@ void init_pwm(void)
    a 100% duty cycle has no switching
    and consequently will not boost.  
 */
-void pwm_duty(double dutyCycle) 
+void pwm_duty(uint8_t x) 
 {
-    uint8_t x = (uint8_t)(PWM_DUTY_MAX*dutyCycle);
-    
     //printf("PWM=%4u  ==>  ", x);  
 
     OCR2A = x;